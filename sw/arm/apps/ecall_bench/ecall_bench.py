@@ -0,0 +1,21 @@
+# Copyright 2023 EPFL
+# Solderpad Hardware License, Version 2.1, see LICENSE.md for details.
+# SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+
+# Import the X-HEEP Python class
+from pynq import x_heep
+
+# Load the X-HEEP bitstream
+x_heep = x_heep()
+
+# Compile the application
+x_heep.compile_app("ecall_bench")
+
+# Run the application
+x_heep.run_app()
+
+# Print the measured U-mode ecall round trips, through syscall_entry and
+# through the C dispatcher it replaced
+stdout_path = "/home/xilinx/x-heep-femu-sdk/sw/riscv/build/stdout.txt"
+f = open(stdout_path, "r")
+print(f.read().strip())
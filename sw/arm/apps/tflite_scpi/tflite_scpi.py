@@ -0,0 +1,45 @@
+# Copyright 2023 EPFL
+# Solderpad Hardware License, Version 2.1, see LICENSE.md for details.
+# SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+
+import sys
+import time
+import numpy as np
+
+# Import the X-HEEP Python class and the SCPI client
+from pynq import x_heep
+sys.path.append("/home/xilinx/x-heep-femu-sdk/sw/arm/sdk")
+from x_heep_scpi import XHeepScpiClient
+
+# Load the X-HEEP bitstream
+x_heep = x_heep()
+
+# Compile the application
+x_heep.compile_app("tflite_scpi")
+
+# Count cycles for the whole run and sample them with the perf_region id
+perf_cnt = x_heep.init_perf_cnt()
+x_heep.start_perf_cnt_automatic(perf_cnt)
+
+# Open the UART before starting the server, then run it
+client = XHeepScpiClient(window=2)
+x_heep.load_app_fast()
+x_heep.start_perf_cnt_sampling(perf_cnt, period=0.001, regions=True)
+
+# Send random LeNet-5 inputs and measure the sustained throughput
+n_requests = 32
+inputs = [np.random.randint(-128, 128, size=32*32, dtype=np.int8) for i in range(n_requests)]
+start = time.monotonic()
+scores = list(client.infer_many(inputs))
+elapsed = time.monotonic() - start
+series = x_heep.stop_perf_cnt_sampling(perf_cnt)
+
+print("%d inferences in %.2f s (%.2f inf/s)" % (n_requests, elapsed, n_requests / elapsed))
+print("Last scores: " + str(list(scores[-1])))
+
+# Time spent in each region of main.c and the runtime
+names = {0: 'idle', 1: 'scpi input', 8: 'invoke', 9: 'format'}
+for name, deltas in x_heep.perf_cnt_by_region(series, names).items():
+    metrics = x_heep.perf_cnt_metrics(deltas)
+    print("%-12s %10.6f s  cpu active %5.1f%%" % (name, metrics['total time'], 100 * metrics['active ratio'][0]))
+client.close()
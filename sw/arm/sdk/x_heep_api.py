@@ -11,7 +11,12 @@ from pynq import GPIO
 import os
 import sys
 import csv
+import glob
+import re
 import time
+import threading
+import struct
+import numpy as np
 
 ADC_OFFSET                         = 0x40000000
 FLASH_AXI_ADDRESS_ADDER_OFFSET     = 0x43C00000
@@ -20,6 +25,73 @@ PERFORMANCE_COUNTERS_OFFSET        = 0x43C20000
 R_OBI_AXI_BRIDGE_OFFSET            = 0x43C30000
 R_OBI_BAA_AXI_ADDRESS_ADDER_OFFSET = 0x43C40000
 
+R_OBI_WINDOW_SIZE                  = 0x00008000
+SOC_CTRL_START_ADDRESS             = 0x20000000
+SOC_CTRL_BOOT_EXIT_LOOP_OFFSET     = 0xC
+SOC_CTRL_BOOT_ADDRESS_OFFSET       = 0x10
+
+ADC_MEM_SIZE                       = 8192
+FILE_CHUNK_SIZE                    = 1048576
+
+# perf_region markers: the firmware drives the id of the innermost open region
+# on X-HEEP GPIO_AO pins 2-7, which reach the PS as GPIO pins 8-13
+PERF_REGION_FIRST_PIN              = 2
+PERF_REGION_PINS                   = 6
+PERF_REGION_PS_PIN_OFFSET          = 6
+PERF_REGION_NAMES                  = {0: 'none', 1: 'scpi input', 8: 'invoke', 9: 'format'}
+
+# Zynq PS GPIO controller: DATA_RO of bank 2 holds the values of EMIO pins
+# 0-31, the PS GPIO pins of GPIO.get_gpio_pin()
+ZYNQ_GPIO_OFFSET                   = 0xE000A000
+ZYNQ_GPIO_SIZE                     = 0x1000
+ZYNQ_GPIO_EMIO_DATA_RO             = 0x68
+
+# Performance counters: word 0 resets, word 1 selects the mode, word 2 counts
+# the total cycles. Each entry maps a module to the word offsets of its
+# active, clock-gate, power-gate and retentive cycle counters (None if the
+# module does not have that state). The shipped bitstream counts the 4 RAM
+# banks in words 45-60; extend PERF_CNT_RAM_BANKS only along with a bitstream
+# that has more counters.
+PERF_CNT_CLK_FREQ_HZ = 20000000
+PERF_CNT_RESET       = 0
+PERF_CNT_MODE        = 1
+PERF_CNT_TOTAL       = 2
+PERF_CNT_STATES      = ('active', 'clock-gate', 'power-gate', 'retentive')
+PERF_CNT_RAM_BANKS   = 4
+
+PERF_CNT_MAP = [
+    ('',                               'cpu',              (3, 4, 5, None)),
+    ('',                               'bus ao',           (6, 7, None, None)),
+    ('',                               'debug ao',         (8, 9, None, None)),
+    ('always-on peripheral subsystem', 'soc ctrl ao',      (10, 11, None, None)),
+    ('always-on peripheral subsystem', 'boot rom ao',      (12, 13, None, None)),
+    ('always-on peripheral subsystem', 'spi flash ao',     (14, 15, None, None)),
+    ('always-on peripheral subsystem', 'spi ao',           (16, 17, None, None)),
+    ('always-on peripheral subsystem', 'power manager ao', (18, 19, None, None)),
+    ('always-on peripheral subsystem', 'timer ao',         (20, 21, None, None)),
+    ('always-on peripheral subsystem', 'dma ao',           (22, 23, None, None)),
+    ('always-on peripheral subsystem', 'fast int ctrl ao', (24, 25, None, None)),
+    ('always-on peripheral subsystem', 'gpio ao',          (26, 27, None, None)),
+    ('always-on peripheral subsystem', 'uart ao',          (28, 29, None, None)),
+    ('peripheral subsystem',           'plic',             (30, 31, 32, None)),
+    ('peripheral subsystem',           'gpio',             (33, 34, 35, None)),
+    ('peripheral subsystem',           'i2c',              (36, 37, 38, None)),
+    ('peripheral subsystem',           'timer',            (39, 40, 41, None)),
+    ('peripheral subsystem',           'spi',              (42, 43, 44, None)),
+] + [
+    ('memory subsystem',               'ram bank %d' % i,  (45 + 4*i, 46 + 4*i, 47 + 4*i, 48 + 4*i)) for i in range(PERF_CNT_RAM_BANKS)
+]
+
+PERF_CNT_INDEX       = np.array([[-1 if word is None else word for word in words] for subsystem, module, words in PERF_CNT_MAP])
+PERF_CNT_PRESENT     = PERF_CNT_INDEX >= 0
+PERF_CNT_WINDOW_SIZE = 4 * (int(PERF_CNT_INDEX.max()) + 1)
+PERF_CNT_DTYPE       = [('subsystem', 'U32'), ('module', 'U32')] + [(state, np.float64) for state in PERF_CNT_STATES]
+
+# Power tables, one CSV per cell library and characterization frequency
+# (TSMC_65nm_<cells>_<freq>MHz.csv) with the leakage, dynamic, total and
+# retentive power of each module in W
+PWR_VAL_DIR          = "/home/xilinx/x-heep-femu-sdk/sw/riscv/pwr_val/"
+
 class x_heep(Overlay):
 
     def __init__(self, **kwargs):
@@ -57,6 +129,74 @@ class x_heep(Overlay):
         os.system("/home/xilinx/x-heep-femu-sdk/sw/arm/sdk/run_app.sh debug")
 
 
+    def load_app_fast(self, elf_file="/home/xilinx/x-heep-femu-sdk/sw/riscv/build/code.elf", verify=False):
+
+        # Load application through the reverse OBI bridge instead of JTAG and start it.
+        # X-HEEP is reset into the boot ROM JTAG loop, the loadable segments are written
+        # window by window, then the boot address is set and the boot loop released.
+        # Application output goes to the UART as usual (see run_app.sh).
+        entry, segments = self.read_elf_segments(elf_file)
+
+        self.release_boot_select()
+        self.release_execute_from_flash()
+        self.reset_pulse()
+
+        reverse_obi_bridge = MMIO(R_OBI_AXI_BRIDGE_OFFSET, R_OBI_WINDOW_SIZE)
+        for address, data in segments:
+            self.write_r_obi_bytes(reverse_obi_bridge, address, data, verify)
+
+        self.init_r_obi(SOC_CTRL_START_ADDRESS // R_OBI_WINDOW_SIZE)
+        reverse_obi_bridge.write(SOC_CTRL_BOOT_ADDRESS_OFFSET, entry)
+        reverse_obi_bridge.write(SOC_CTRL_BOOT_EXIT_LOOP_OFFSET, 1)
+
+
+    def read_elf_segments(self, elf_file):
+
+        # Return the entry point and the (address, bytes) pairs of the PT_LOAD segments of a
+        # 32-bit little-endian ELF, i.e. what GDB "load" writes
+        with open(elf_file, mode="rb") as file:
+            elf = file.read()
+        if elf[0:4] != b"\x7fELF" or elf[4] != 1 or elf[5] != 1:
+            raise ValueError(elf_file + " is not a 32-bit little-endian ELF")
+        entry, phoff = struct.unpack_from("<II", elf, 24)
+        phentsize, phnum = struct.unpack_from("<HH", elf, 42)
+        segments = []
+        for i in range(phnum):
+            p_type, p_offset, p_vaddr, p_paddr, p_filesz = struct.unpack_from("<IIIII", elf, phoff + i*phentsize)
+            if p_type == 1 and p_filesz > 0:
+                segments.append((p_paddr, elf[p_offset:p_offset + p_filesz]))
+        return entry, segments
+
+
+    def write_r_obi_bytes(self, reverse_obi_bridge, address, data, verify=False):
+
+        # Write a byte string to X-HEEP memory one reverse OBI window at a time. Partial
+        # words at either end are merged with the current memory content. The image is
+        # assembled into words in DRAM; the bridge only sees 32-bit MMIO accesses.
+        end = address + len(data)
+        while address < end:
+            window = address // R_OBI_WINDOW_SIZE
+            chunk_end = min(end, (window + 1) * R_OBI_WINDOW_SIZE)
+            first_word = (address % R_OBI_WINDOW_SIZE) // 4
+            last_word = (chunk_end - window * R_OBI_WINDOW_SIZE + 3) // 4
+            self.init_r_obi(window)
+
+            words = np.zeros(last_word - first_word, dtype=np.uint32)
+            byte_offset = address % 4
+            if byte_offset != 0:
+                words[0] = reverse_obi_bridge.read(first_word*4)
+            if chunk_end % 4 != 0:
+                words[-1] = reverse_obi_bridge.read((last_word - 1)*4)
+            words.view(np.uint8)[byte_offset:byte_offset + chunk_end - address] = np.frombuffer(data, dtype=np.uint8, count=chunk_end - address, offset=len(data) - (end - address))
+            self.write_mmio_words(reverse_obi_bridge, first_word, words)
+
+            if verify:
+                for i, word in enumerate(words.tolist()):
+                    if reverse_obi_bridge.read((first_word + i)*4) != word:
+                        raise RuntimeError("Reverse OBI readback mismatch at " + hex(window * R_OBI_WINDOW_SIZE + (first_word + i) * 4))
+            address = chunk_end
+
+
     def assert_reset(self):
 
         # Set the active-high GPIO reset to 1 (active-low X-HEEP reset to 0)
@@ -148,30 +288,24 @@ class x_heep(Overlay):
     def write_flash(self, flash):
 
         # Write Flash from binary file
-        file = open("/home/xilinx/x-heep-femu-sdk/sw/riscv/build/flash_in.bin", mode="rb")
-        file_byte = file.read()
-        for i in range(int(len(file_byte)/4)):
-            flash[i] = (file_byte[i*4+3] << 24) | (file_byte[i*4+2] << 16) | (file_byte[i*4+1] << 8) | file_byte[i*4];
-        file.close()
+        self.read_file_to_buffer("/home/xilinx/x-heep-femu-sdk/sw/riscv/build/flash_in.bin", flash.view(np.uint8))
+        flash.flush()
 
 
     def read_flash(self, flash):
 
         # Read Flash to binary file
-        file = open("/home/xilinx/x-heep-femu-sdk/sw/riscv/build/flash_out.bin", mode="wb")
-        byte_array = bytearray(flash)
-        file.write(byte_array)
-        file.close()
+        flash.invalidate()
+        self.write_buffer_to_file("/home/xilinx/x-heep-femu-sdk/sw/riscv/build/flash_out.bin", flash.view(np.uint8))
 
 
     def init_adc_mem(self):
 
         # Map ADC memory
-        adc_mem = MMIO(ADC_OFFSET, 8192)
+        adc_mem = MMIO(ADC_OFFSET, ADC_MEM_SIZE)
 
         # Reset ADC memory
-        for i in range(2048):
-            adc_mem.write(i*4, 0x0)
+        self.write_mmio_words(adc_mem, 0, np.zeros(ADC_MEM_SIZE // 4, dtype=np.uint32))
 
         return adc_mem
 
@@ -179,27 +313,56 @@ class x_heep(Overlay):
     def reset_adc_mem(self, adc_mem):
 
         # Reset ADC mem
-        for i in range(2048):
-            adc_mem.write(i*4, 0x0)
+        self.write_mmio_words(adc_mem, 0, np.zeros(ADC_MEM_SIZE // 4, dtype=np.uint32))
 
 
     def write_adc_mem(self, adc_mem):
 
-        # Write ADC memory from binary file
-        file = open("/home/xilinx/x-heep-femu-sdk/sw/riscv/build/adc_in.bin", mode="rb")
-        file_byte = file.read()
-        for i in range(int(len(file_byte)/4)):
-            adc_mem.write(i*4, (file_byte[i*4+3] << 24) | (file_byte[i*4+2] << 16) | (file_byte[i*4+1] << 8) | file_byte[i*4])
-        file.close()
+        # Write ADC memory from binary file, parsed into words in DRAM first
+        adc_in = np.zeros(ADC_MEM_SIZE // 4, dtype=np.uint32)
+        n_bytes = self.read_file_to_buffer("/home/xilinx/x-heep-femu-sdk/sw/riscv/build/adc_in.bin", adc_in.view(np.uint8))
+        n_words = (n_bytes + 3) // 4
+        self.write_mmio_words(adc_mem, 0, adc_in[:n_words])
+
+
+    def write_mmio_words(self, mmio, first_word, words):
+
+        # Write words to an MMIO window from word index first_word, one MMIO.write
+        # each: slice assignments to mmio.array go through memcpy, which may issue
+        # byte or burst accesses the ADC memory and the reverse OBI bridge do not
+        # accept
+        for i, word in enumerate(words.tolist()):
+            mmio.write((first_word + i)*4, word)
 
 
     def read_adc_mem(self, adc_mem):
 
         # Read ADC memory to binary file
-        file = open("/home/xilinx/x-heep-femu-sdk/sw/riscv/build/adc_out.bin", mode="wb")
-        for i in range(2048):
-            file.write(adc_mem.read(i*4).to_bytes(4, 'little'))
-        file.close()
+        adc_out = np.array(adc_mem.array, dtype=np.uint32)
+        self.write_buffer_to_file("/home/xilinx/x-heep-femu-sdk/sw/riscv/build/adc_out.bin", adc_out.view(np.uint8))
+
+
+    def read_file_to_buffer(self, file_name, buffer):
+
+        # Fill a uint8 buffer view from a binary file in chunks
+        if os.path.getsize(file_name) > len(buffer):
+            raise ValueError(file_name + " does not fit in " + str(len(buffer)) + " bytes")
+        n_bytes = 0
+        with open(file_name, mode="rb") as file:
+            while n_bytes < len(buffer):
+                n_read = file.readinto(buffer[n_bytes:n_bytes + FILE_CHUNK_SIZE])
+                if not n_read:
+                    break
+                n_bytes += n_read
+        return n_bytes
+
+
+    def write_buffer_to_file(self, file_name, buffer):
+
+        # Dump a uint8 buffer view to a binary file in chunks
+        with open(file_name, mode="wb") as file:
+            for offset in range(0, len(buffer), FILE_CHUNK_SIZE):
+                file.write(buffer[offset:offset + FILE_CHUNK_SIZE])
 
 
     def init_ddr_mem(self, mem_size):
@@ -288,11 +451,11 @@ class x_heep(Overlay):
     def init_perf_cnt(self):
 
         # Map performance counters
-        perf_cnt = MMIO(PERFORMANCE_COUNTERS_OFFSET, 256)
+        perf_cnt = MMIO(PERFORMANCE_COUNTERS_OFFSET, PERF_CNT_WINDOW_SIZE)
 
         # Reset performance counters
-        perf_cnt.write(0x0, 0x1)
-        perf_cnt.write(0x0, 0x0)
+        perf_cnt.write(PERF_CNT_RESET*4, 0x1)
+        perf_cnt.write(PERF_CNT_RESET*4, 0x0)
 
         return perf_cnt
 
@@ -300,464 +463,316 @@ class x_heep(Overlay):
     def reset_perf_cnt(self, perf_cnt):
 
         # Reset performance counters
-        perf_cnt.write(0x0, 0x1)
-        perf_cnt.write(0x0, 0x0)
+        perf_cnt.write(PERF_CNT_RESET*4, 0x1)
+        perf_cnt.write(PERF_CNT_RESET*4, 0x0)
 
 
     def start_perf_cnt_automatic(self, perf_cnt):
 
         # Start perf cnt in automatic mode
-        perf_cnt.write(0x4, 0x1)
+        perf_cnt.write(PERF_CNT_MODE*4, 0x1)
 
 
     def start_perf_cnt_manual(self, perf_cnt):
 
         # Start perf cnt in manual mode
-        perf_cnt.write(0x4, 0x2)
+        perf_cnt.write(PERF_CNT_MODE*4, 0x2)
 
 
     def stop_perf_cnt(self, perf_cnt):
 
         # Stop performance counters
-        perf_cnt.write(0x4, 0x0)
+        perf_cnt.write(PERF_CNT_MODE*4, 0x0)
+
+
+    def snapshot_perf_cnt(self, perf_cnt):
+
+        # Copy the whole counter window in one go. Cheap enough to be called
+        # periodically while an application runs.
+        return np.array(perf_cnt.array, dtype=np.uint32)
+
+
+    def perf_cnt_table(self, snapshot, scale=1.0):
+
+        # Gather a snapshot into one row per module of PERF_CNT_MAP, with the
+        # cycles of each state multiplied by scale (NaN for missing states)
+        values = np.where(PERF_CNT_PRESENT, snapshot[np.maximum(PERF_CNT_INDEX, 0)] * float(scale), np.nan)
+        table = np.zeros(len(PERF_CNT_MAP), dtype=PERF_CNT_DTYPE)
+        table['subsystem'] = [subsystem for subsystem, module, words in PERF_CNT_MAP]
+        table['module'] = [module for subsystem, module, words in PERF_CNT_MAP]
+        for i, state in enumerate(PERF_CNT_STATES):
+            table[state] = values[:, i]
+        return table
+
+
+    def read_perf_region(self):
+
+        # Read the id of the region the firmware is in (see perf_region.h). The
+        # firmware sets all marker pins in one write; they are read back in one
+        # access to DATA_RO as well, so a region change is never seen half-way.
+        if not hasattr(self, 'perf_region_pins'):
+            self.perf_region_pins = [GPIO(GPIO.get_gpio_pin(PERF_REGION_FIRST_PIN + i + PERF_REGION_PS_PIN_OFFSET), 'in')
+                                     for i in range(PERF_REGION_PINS)]
+            self.perf_region_gpio = MMIO(ZYNQ_GPIO_OFFSET, ZYNQ_GPIO_SIZE)
+        data = self.perf_region_gpio.read(ZYNQ_GPIO_EMIO_DATA_RO)
+        return (data >> (PERF_REGION_FIRST_PIN + PERF_REGION_PS_PIN_OFFSET)) & ((1 << PERF_REGION_PINS) - 1)
+
+
+    def start_perf_cnt_sampling(self, perf_cnt, period=0.01, max_samples=100000, regions=False):
+
+        # Snapshot the counters every period seconds from a background thread
+        # until stop_perf_cnt_sampling() is called or max_samples are taken.
+        # With regions, the perf_region id is read right after each snapshot.
+        sampling = {
+            'snapshots': np.zeros((max_samples, PERF_CNT_WINDOW_SIZE // 4), dtype=np.uint32),
+            'times':     np.zeros(max_samples),
+            'regions':   np.zeros(max_samples, dtype=np.uint8) if regions else None,
+            'count':     0,
+            'stop':      threading.Event(),
+        }
+
+        def sample():
+            next_time = time.monotonic()
+            while sampling['count'] < max_samples:
+                sampling['times'][sampling['count']] = time.monotonic()
+                sampling['snapshots'][sampling['count']] = perf_cnt.array
+                if regions:
+                    sampling['regions'][sampling['count']] = self.read_perf_region()
+                sampling['count'] += 1
+                next_time += period
+                if sampling['stop'].wait(max(0.0, next_time - time.monotonic())):
+                    break
+
+        sampling['thread'] = threading.Thread(target=sample, daemon=True)
+        self.perf_cnt_sampling = sampling
+        sampling['thread'].start()
+
+
+    def stop_perf_cnt_sampling(self, perf_cnt, clk_freq_hz=PERF_CNT_CLK_FREQ_HZ):
+
+        # Stop the sampler, take a last snapshot and return the time series
+        sampling = self.perf_cnt_sampling
+        sampling['stop'].set()
+        sampling['thread'].join()
+        count = sampling['count']
+        times = np.append(sampling['times'][:count], time.monotonic())
+        snapshots = np.vstack([sampling['snapshots'][:count], self.snapshot_perf_cnt(perf_cnt)])
+        regions = sampling['regions'][:count] if sampling['regions'] is not None else None
+        del self.perf_cnt_sampling
+        return self.perf_cnt_time_series(times, snapshots, clk_freq_hz, regions)
+
+
+    def perf_cnt_time_series(self, times, snapshots, clk_freq_hz=PERF_CNT_CLK_FREQ_HZ, regions=None):
+
+        # Per-interval counter deltas between consecutive snapshots. 'deltas' holds
+        # raw counter windows (32-bit wrap-around handled), usable as snapshots by
+        # energy_from_snapshots(); 'cycles' is laid out as (interval, module, state)
+        # following PERF_CNT_MAP and PERF_CNT_STATES, NaN for missing states.
+        # 'region' is the region id read at the start of each interval, if any.
+        deltas = np.diff(snapshots, axis=0)
+        cycles = np.where(PERF_CNT_PRESENT, deltas[:, np.maximum(PERF_CNT_INDEX, 0)], np.nan)
+        series = {
+            'time':     times[1:] - times[0],
+            'interval': np.diff(times),
+            'total':    deltas[:, PERF_CNT_TOTAL] / clk_freq_hz,
+            'deltas':   deltas,
+            'cycles':   cycles,
+        }
+        if regions is not None:
+            series['region'] = np.asarray(regions)
+        return series
+
+
+    def perf_cnt_by_region(self, series, names=PERF_REGION_NAMES):
+
+        # Attribute each interval of a series sampled with regions to the region
+        # it started in, and sum the counter deltas per region. Intervals
+        # straddling a region change are charged to the earlier region, so the
+        # resolution is the sampling period. Returns {name: deltas}, each usable
+        # as a snapshot by perf_cnt_metrics() and energy_from_snapshots().
+        by_region = {}
+        for region in np.unique(series['region']):
+            name = names.get(int(region), 'region ' + str(int(region)))
+            by_region[name] = series['deltas'][series['region'] == region].sum(axis=0, dtype=np.uint64)
+        return by_region
+
+
+    def save_perf_cnt_time_series(self, series, file_name="/home/xilinx/x-heep-femu-sdk/sw/riscv/build/perf_cnt_series.csv"):
+
+        # Save a time series with one row per interval and one column per module and state
+        with open(file_name, mode='w') as series_file:
+            writer = csv.writer(series_file, delimiter=',', quotechar='"', quoting=csv.QUOTE_MINIMAL)
+            columns = [(i, j) for i in range(len(PERF_CNT_MAP)) for j in range(len(PERF_CNT_STATES)) if PERF_CNT_PRESENT[i, j]]
+            region = ['region'] if 'region' in series else []
+            writer.writerow(['time', 'interval', 'x-heep time'] + region + [PERF_CNT_MAP[i][1] + ' ' + PERF_CNT_STATES[j] + ' cycles' for i, j in columns])
+            for k in range(len(series['time'])):
+                region = [int(series['region'][k])] if 'region' in series else []
+                writer.writerow([series['time'][k], series['interval'][k], series['total'][k]] + region + [int(series['cycles'][k, i, j]) for i, j in columns])
+
+
+    def perf_cnt_metrics(self, snapshot, clk_freq_hz=PERF_CNT_CLK_FREQ_HZ):
+
+        # Derived metrics of a snapshot: time spent in each state per module,
+        # total time and the fraction of the total each module was active
+        total_time = float(snapshot[PERF_CNT_TOTAL]) / clk_freq_hz
+        times = self.perf_cnt_table(snapshot, 1.0 / clk_freq_hz)
+        duty_cycle = times['active'] / total_time if total_time > 0 else np.zeros(len(times))
+        return {'total time': total_time, 'times': times, 'active ratio': duty_cycle}
+
+
+    def write_perf_cnt_csv(self, file_name, header, table, total_name, total, fmt):
+
+        # Write a per-module table with the layout used by all the estimation CSV files
+        with open(file_name, mode='w') as csv_file:
+            writer = csv.writer(csv_file, delimiter=',', quotechar='"', quoting=csv.QUOTE_MINIMAL)
+            writer.writerow(['module', '', ''] + [state + ' ' + header for state in PERF_CNT_STATES] + [''])
+            writer.writerow(['x-heep', '', '', '', '', '', '', ''])
+            subsystem = ''
+            for row in table:
+                if row['subsystem'] != subsystem:
+                    subsystem = row['subsystem']
+                    writer.writerow(['', subsystem, '', '', '', '', '', ''])
+                name = ['', '', row['module']] if subsystem else ['', row['module'], '']
+                writer.writerow(name + ['-' if np.isnan(row[state]) else fmt(row[state]) for state in PERF_CNT_STATES] + [''])
+            writer.writerow(['', '', '', '', '', '', '', ''])
+            writer.writerow([total_name, '', '', '', '', '', '', fmt(total)])
+
+
+    def read_perf_cnt_csv(self):
+
+        # Read back the counters saved by read_perf_cnt() as a snapshot
+        snapshot = np.zeros(PERF_CNT_WINDOW_SIZE // 4, dtype=np.uint32)
+        with open('/home/xilinx/x-heep-femu-sdk/sw/riscv/build/perf_cnt.csv') as perf_cnt_file:
+            rows = [row for row in csv.reader(perf_cnt_file, delimiter=',') if any(row)]
+        module_rows = [row for row in rows[2:-1] if row[3] != '']
+        for (subsystem, module, words), row in zip(PERF_CNT_MAP, module_rows):
+            for word, value in zip(words, row[3:7]):
+                if word is not None:
+                    snapshot[word] = int(value, base=16)
+        snapshot[PERF_CNT_TOTAL] = int(rows[-1][7], base=16)
+        return snapshot
 
 
     def read_perf_cnt(self, perf_cnt):
 
         # Save performance counters to CSV file
-        with open('/home/xilinx/x-heep-femu-sdk/sw/riscv/build/perf_cnt.csv', mode='w') as perf_cnt_file:
-            perf_cnt_writer = csv.writer(perf_cnt_file, delimiter=',', quotechar='"', quoting=csv.QUOTE_MINIMAL)
-
-            perf_cnt_writer.writerow(['module', '', '',                        'active cycles',        'clock-gate cycles',        'power-gate cycles',         'retentive cycles', ''])
-            perf_cnt_writer.writerow(['x-heep', '', '',                                     '',                         '',                         '',                         '', ''])
-            perf_cnt_writer.writerow(['', 'cpu', '',                 (hex(perf_cnt.read(3*4))),  (hex(perf_cnt.read(4*4))),  (hex(perf_cnt.read(5*4))),                        '-', ''])
-            perf_cnt_writer.writerow(['', 'bus ao', '',              (hex(perf_cnt.read(6*4))),  (hex(perf_cnt.read(7*4))),                        '-',                        '-', ''])
-            perf_cnt_writer.writerow(['', 'debug ao', '',            (hex(perf_cnt.read(8*4))),  (hex(perf_cnt.read(9*4))),                        '-',                        '-', ''])
-            perf_cnt_writer.writerow(['', 'always-on peripheral subsystem', '',             '',                         '',                         '',                         '', ''])
-            perf_cnt_writer.writerow(['', '', 'soc ctrl ao',        (hex(perf_cnt.read(10*4))), (hex(perf_cnt.read(11*4))),                        '-',                        '-', ''])
-            perf_cnt_writer.writerow(['', '', 'boot rom ao',        (hex(perf_cnt.read(12*4))), (hex(perf_cnt.read(13*4))),                        '-',                        '-', ''])
-            perf_cnt_writer.writerow(['', '', 'spi flash ao',       (hex(perf_cnt.read(14*4))), (hex(perf_cnt.read(15*4))),                        '-',                        '-', ''])
-            perf_cnt_writer.writerow(['', '', 'spi ao',             (hex(perf_cnt.read(16*4))), (hex(perf_cnt.read(17*4))),                        '-',                        '-', ''])
-            perf_cnt_writer.writerow(['', '', 'power manager ao',   (hex(perf_cnt.read(18*4))), (hex(perf_cnt.read(19*4))),                        '-',                        '-', ''])
-            perf_cnt_writer.writerow(['', '', 'timer ao',           (hex(perf_cnt.read(20*4))), (hex(perf_cnt.read(21*4))),                        '-',                        '-', ''])
-            perf_cnt_writer.writerow(['', '', 'dma ao',             (hex(perf_cnt.read(22*4))), (hex(perf_cnt.read(23*4))),                        '-',                        '-', ''])
-            perf_cnt_writer.writerow(['', '', 'fast int ctrl ao',   (hex(perf_cnt.read(24*4))), (hex(perf_cnt.read(25*4))),                        '-',                        '-', ''])
-            perf_cnt_writer.writerow(['', '', 'gpio ao',            (hex(perf_cnt.read(26*4))), (hex(perf_cnt.read(27*4))),                        '-',                        '-', ''])
-            perf_cnt_writer.writerow(['', '', 'uart ao',            (hex(perf_cnt.read(28*4))), (hex(perf_cnt.read(29*4))),                        '-',                        '-', ''])
-            perf_cnt_writer.writerow(['', 'peripheral subsystem', '',                       '',                         '',                         '',                         '', ''])
-            perf_cnt_writer.writerow(['', '', 'plic',               (hex(perf_cnt.read(30*4))), (hex(perf_cnt.read(31*4))), (hex(perf_cnt.read(32*4))),                        '-', ''])
-            perf_cnt_writer.writerow(['', '', 'gpio',               (hex(perf_cnt.read(33*4))), (hex(perf_cnt.read(34*4))), (hex(perf_cnt.read(35*4))),                        '-', ''])
-            perf_cnt_writer.writerow(['', '', 'i2c',                (hex(perf_cnt.read(36*4))), (hex(perf_cnt.read(37*4))), (hex(perf_cnt.read(38*4))),                        '-', ''])
-            perf_cnt_writer.writerow(['', '', 'timer',              (hex(perf_cnt.read(39*4))), (hex(perf_cnt.read(40*4))), (hex(perf_cnt.read(41*4))),                        '-', ''])
-            perf_cnt_writer.writerow(['', '', 'spi',                (hex(perf_cnt.read(42*4))), (hex(perf_cnt.read(43*4))), (hex(perf_cnt.read(44*4))),                        '-', ''])
-            perf_cnt_writer.writerow(['', 'memory subsystem', '',                           '',                         '',                         '',                         '', ''])
-            perf_cnt_writer.writerow(['', '', 'ram bank 0',         (hex(perf_cnt.read(45*4))), (hex(perf_cnt.read(46*4))), (hex(perf_cnt.read(47*4))), (hex(perf_cnt.read(48*4))), ''])
-            perf_cnt_writer.writerow(['', '', 'ram bank 1',         (hex(perf_cnt.read(49*4))), (hex(perf_cnt.read(50*4))), (hex(perf_cnt.read(51*4))), (hex(perf_cnt.read(52*4))), ''])
-            perf_cnt_writer.writerow(['', '', 'ram bank 2',         (hex(perf_cnt.read(53*4))), (hex(perf_cnt.read(54*4))), (hex(perf_cnt.read(55*4))), (hex(perf_cnt.read(56*4))), ''])
-            perf_cnt_writer.writerow(['', '', 'ram bank 3',         (hex(perf_cnt.read(57*4))), (hex(perf_cnt.read(58*4))), (hex(perf_cnt.read(59*4))), (hex(perf_cnt.read(60*4))), ''])
-            perf_cnt_writer.writerow(['', '', '', '', '', '', '', ''])
-            perf_cnt_writer.writerow(['Total cycles', '', '', '', '', '', '', (hex(perf_cnt.read(2*4)))])
-
-            perf_cnt_file.close()
-
-
-    def estimate_performance(self):
-
-        with open('/home/xilinx/x-heep-femu-sdk/sw/riscv/build/perf_cnt.csv') as perf_cnt_file:
-            perf_cnt_reader = csv.reader(perf_cnt_file, delimiter=',')
-            perf_cnt = []
-            for row in perf_cnt_reader:
-                perf_cnt.append(row)
-
-            with open('/home/xilinx/x-heep-femu-sdk/sw/riscv/build/perf_estim.csv', mode='w') as perf_estim_file:
-                perf_estim_writer = csv.writer(perf_estim_file, delimiter=',', quotechar='"', quoting=csv.QUOTE_MINIMAL)
-
-                # Save performance estimation to CSV file
-                perf_estim_writer.writerow(['module', '', '',                                                             'active cycles',                                    'clock-gate cycles',                                    'power-gate cycles',                                     'retentive cycles', ''])
-                perf_estim_writer.writerow(['x-heep', '', '',                                                                          '',                                                     '',                                                     '',                                                     '', ''])
-                perf_estim_writer.writerow(['', 'cpu', '',                          float(int(perf_cnt[2][3], base=16)*float(0.00000005)),  float(int(perf_cnt[2][4], base=16)*float(0.00000005)),  float(int(perf_cnt[2][5], base=16)*float(0.00000005)),                                                    '-', ''])
-                perf_estim_writer.writerow(['', 'bus ao', '',                       float(int(perf_cnt[3][3], base=16)*float(0.00000005)),  float(int(perf_cnt[3][4], base=16)*float(0.00000005)),                                                    '-',                                                    '-', ''])
-                perf_estim_writer.writerow(['', 'debug ao', '',                     float(int(perf_cnt[4][3], base=16)*float(0.00000005)),  float(int(perf_cnt[4][4], base=16)*float(0.00000005)),                                                    '-',                                                    '-', ''])
-                perf_estim_writer.writerow(['', 'always-on peripheral subsystem', '',                                                  '',                                                     '',                                                     '',                                                     '', ''])
-                perf_estim_writer.writerow(['', '', 'soc ctrl ao',                  float(int(perf_cnt[6][3], base=16)*float(0.00000005)),  float(int(perf_cnt[6][4], base=16)*float(0.00000005)),                                                    '-',                                                    '-', ''])
-                perf_estim_writer.writerow(['', '', 'boot rom ao',                  float(int(perf_cnt[7][3], base=16)*float(0.00000005)),  float(int(perf_cnt[7][4], base=16)*float(0.00000005)),                                                    '-',                                                    '-', ''])
-                perf_estim_writer.writerow(['', '', 'spi flash ao',                 float(int(perf_cnt[8][3], base=16)*float(0.00000005)),  float(int(perf_cnt[8][4], base=16)*float(0.00000005)),                                                    '-',                                                    '-', ''])
-                perf_estim_writer.writerow(['', '', 'spi ao',                       float(int(perf_cnt[9][3], base=16)*float(0.00000005)),  float(int(perf_cnt[9][4], base=16)*float(0.00000005)),                                                    '-',                                                    '-', ''])
-                perf_estim_writer.writerow(['', '', 'power manager ao',            float(int(perf_cnt[10][3], base=16)*float(0.00000005)), float(int(perf_cnt[10][4], base=16)*float(0.00000005)),                                                    '-',                                                    '-', ''])
-                perf_estim_writer.writerow(['', '', 'timer ao',                    float(int(perf_cnt[11][3], base=16)*float(0.00000005)), float(int(perf_cnt[11][4], base=16)*float(0.00000005)),                                                    '-',                                                    '-', ''])
-                perf_estim_writer.writerow(['', '', 'dma ao',                      float(int(perf_cnt[12][3], base=16)*float(0.00000005)), float(int(perf_cnt[12][4], base=16)*float(0.00000005)),                                                    '-',                                                    '-', ''])
-                perf_estim_writer.writerow(['', '', 'fast int ctrl ao',            float(int(perf_cnt[13][3], base=16)*float(0.00000005)), float(int(perf_cnt[13][4], base=16)*float(0.00000005)),                                                    '-',                                                    '-', ''])
-                perf_estim_writer.writerow(['', '', 'gpio ao',                     float(int(perf_cnt[14][3], base=16)*float(0.00000005)), float(int(perf_cnt[14][4], base=16)*float(0.00000005)),                                                    '-',                                                    '-', ''])
-                perf_estim_writer.writerow(['', '', 'uart ao',                     float(int(perf_cnt[15][3], base=16)*float(0.00000005)), float(int(perf_cnt[15][4], base=16)*float(0.00000005)),                                                    '-',                                                    '-', ''])
-                perf_estim_writer.writerow(['', 'peripheral subsystem', '',                                                            '',                                                     '',                                                     '',                                                     '', ''])
-                perf_estim_writer.writerow(['', '', 'plic',                        float(int(perf_cnt[17][3], base=16)*float(0.00000005)), float(int(perf_cnt[17][4], base=16)*float(0.00000005)), float(int(perf_cnt[17][5], base=16)*float(0.00000005)),                                                    '-', ''])
-                perf_estim_writer.writerow(['', '', 'gpio',                        float(int(perf_cnt[18][3], base=16)*float(0.00000005)), float(int(perf_cnt[18][4], base=16)*float(0.00000005)), float(int(perf_cnt[18][5], base=16)*float(0.00000005)),                                                    '-', ''])
-                perf_estim_writer.writerow(['', '', 'i2c',                         float(int(perf_cnt[19][3], base=16)*float(0.00000005)), float(int(perf_cnt[19][4], base=16)*float(0.00000005)), float(int(perf_cnt[19][5], base=16)*float(0.00000005)),                                                    '-', ''])
-                perf_estim_writer.writerow(['', '', 'timer',                       float(int(perf_cnt[20][3], base=16)*float(0.00000005)), float(int(perf_cnt[20][4], base=16)*float(0.00000005)), float(int(perf_cnt[20][5], base=16)*float(0.00000005)),                                                    '-', ''])
-                perf_estim_writer.writerow(['', '', 'spi',                         float(int(perf_cnt[21][3], base=16)*float(0.00000005)), float(int(perf_cnt[21][4], base=16)*float(0.00000005)), float(int(perf_cnt[21][5], base=16)*float(0.00000005)),                                                    '-', ''])
-                perf_estim_writer.writerow(['', 'memory subsystem', '',                                                                '',                                                     '',                                                     '',                                                     '', ''])
-                perf_estim_writer.writerow(['', '', 'ram bank 0',                  float(int(perf_cnt[23][3], base=16)*float(0.00000005)), float(int(perf_cnt[23][4], base=16)*float(0.00000005)), float(int(perf_cnt[23][5], base=16)*float(0.00000005)), float(int(perf_cnt[23][6], base=16)*float(0.00000005)), ''])
-                perf_estim_writer.writerow(['', '', 'ram bank 1',                  float(int(perf_cnt[24][3], base=16)*float(0.00000005)), float(int(perf_cnt[24][4], base=16)*float(0.00000005)), float(int(perf_cnt[24][5], base=16)*float(0.00000005)), float(int(perf_cnt[24][6], base=16)*float(0.00000005)), ''])
-                perf_estim_writer.writerow(['', '', 'ram bank 2',                  float(int(perf_cnt[25][3], base=16)*float(0.00000005)), float(int(perf_cnt[25][4], base=16)*float(0.00000005)), float(int(perf_cnt[25][5], base=16)*float(0.00000005)), float(int(perf_cnt[25][6], base=16)*float(0.00000005)), ''])
-                perf_estim_writer.writerow(['', '', 'ram bank 3',                  float(int(perf_cnt[26][3], base=16)*float(0.00000005)), float(int(perf_cnt[26][4], base=16)*float(0.00000005)), float(int(perf_cnt[26][5], base=16)*float(0.00000005)), float(int(perf_cnt[26][6], base=16)*float(0.00000005)), ''])
-                perf_estim_writer.writerow(['', '', '', '', '', '', '', ''])
-                perf_estim_writer.writerow(['Total time', '', '', '', '', '', '', float(int(perf_cnt[28][7], base=16)*float(0.00000005))])
-
-                # Print performance estimation to stdout
-                print("\n--- PERFORMANCE ESTIMATION AT 20MHz ---\n")
-
-                print("total time:                 %Es\n"    % (float(int(perf_cnt[28][7], base=16)*float(0.00000005))))
-
-                print("x-heep\n")
-
-                print("    cpu\n")
-
-                print("     - active time:         %Es"      % (float(int(perf_cnt[2][3], base=16)*float(0.00000005))))
-                print("     - clock-gate time:     %Es"      % (float(int(perf_cnt[2][4], base=16)*float(0.00000005))))
-                print("     - power-gate time:     %Es\n"    % (float(int(perf_cnt[2][5], base=16)*float(0.00000005))))
-
-                print("    bus ao\n")
-
-                print("     - active time:         %Es"      % (float(int(perf_cnt[3][3], base=16)*float(0.00000005))))
-                print("     - clock-gate time:     %Es\n"    % (float(int(perf_cnt[3][4], base=16)*float(0.00000005))))
-
-                print("    debug ao\n")
-
-                print("     - active time:         %Es"      % (float(int(perf_cnt[4][3], base=16)*float(0.00000005))))
-                print("     - clock-gate time:     %Es\n"    % (float(int(perf_cnt[4][4], base=16)*float(0.00000005))))
-
-                print("    always-on peripheral subsystem\n")
-
-                print("        soc ctrl ao\n")
-
-                print("         - active time:     %Es"      % (float(int(perf_cnt[6][3], base=16)*float(0.00000005))))
-                print("         - clock-gate time: %Es\n"    % (float(int(perf_cnt[6][4], base=16)*float(0.00000005))))
-
-                print("        boot rom ao\n")
-
-                print("         - active time:     %Es"      % (float(int(perf_cnt[7][3], base=16)*float(0.00000005))))
-                print("         - clock-gate time: %Es\n"    % (float(int(perf_cnt[7][4], base=16)*float(0.00000005))))
-
-                print("        spi flash ao\n")
-
-                print("         - active time:     %Es"      % (float(int(perf_cnt[8][3], base=16)*float(0.00000005))))
-                print("         - clock-gate time: %Es\n"    % (float(int(perf_cnt[8][4], base=16)*float(0.00000005))))
-
-                print("        spi ao\n")
-
-                print("         - active time:     %Es"      % (float(int(perf_cnt[9][3], base=16)*float(0.00000005))))
-                print("         - clock-gate time: %Es\n"    % (float(int(perf_cnt[9][4], base=16)*float(0.00000005))))
-
-                print("        power manager ao\n")
-
-                print("         - active time:     %Es"      % (float(int(perf_cnt[10][3], base=16)*float(0.00000005))))
-                print("         - clock-gate time: %Es\n"    % (float(int(perf_cnt[10][4], base=16)*float(0.00000005))))
-
-                print("        timer ao\n")
-
-                print("         - active time:     %Es"      % (float(int(perf_cnt[11][3], base=16)*float(0.00000005))))
-                print("         - clock-gate time: %Es\n"    % (float(int(perf_cnt[11][4], base=16)*float(0.00000005))))
-
-                print("        dma ao\n")
-
-                print("         - active time:     %Es"      % (float(int(perf_cnt[12][3], base=16)*float(0.00000005))))
-                print("         - clock-gate time: %Es\n"    % (float(int(perf_cnt[12][4], base=16)*float(0.00000005))))
-
-                print("        fast int ctrl ao\n")
-
-                print("         - active time:     %Es"      % (float(int(perf_cnt[13][3], base=16)*float(0.00000005))))
-                print("         - clock-gate time: %Es\n"    % (float(int(perf_cnt[13][4], base=16)*float(0.00000005))))
-
-                print("        gpio ao\n")
-
-                print("         - active time:     %Es"      % (float(int(perf_cnt[14][3], base=16)*float(0.00000005))))
-                print("         - clock-gate time: %Es\n"    % (float(int(perf_cnt[14][4], base=16)*float(0.00000005))))
-
-                print("        uart ao\n")
-
-                print("         - active time:     %Es"      % (float(int(perf_cnt[15][3], base=16)*float(0.00000005))))
-                print("         - clock-gate time: %Es\n"    % (float(int(perf_cnt[15][4], base=16)*float(0.00000005))))
-
-                print("    peripheral subsystem\n")
-
-                print("        plic\n")
-
-                print("         - active time:     %Es"      % (float(int(perf_cnt[17][3], base=16)*float(0.00000005))))
-                print("         - clock-gate time: %Es"      % (float(int(perf_cnt[17][4], base=16)*float(0.00000005))))
-                print("         - power-gate time: %Es\n"    % (float(int(perf_cnt[17][5], base=16)*float(0.00000005))))
-
-                print("        gpio\n")
-
-                print("         - active time:     %Es"      % (float(int(perf_cnt[18][3], base=16)*float(0.00000005))))
-                print("         - clock-gate time: %Es"      % (float(int(perf_cnt[18][4], base=16)*float(0.00000005))))
-                print("         - power-gate time: %Es\n"    % (float(int(perf_cnt[18][5], base=16)*float(0.00000005))))
-
-                print("        i2c\n")
-
-                print("         - active time:     %Es"      % (float(int(perf_cnt[19][3], base=16)*float(0.00000005))))
-                print("         - clock-gate time: %Es"      % (float(int(perf_cnt[19][4], base=16)*float(0.00000005))))
-                print("         - power-gate time: %Es\n"    % (float(int(perf_cnt[19][5], base=16)*float(0.00000005))))
-
-                print("        timer\n")
-
-                print("         - active time:     %Es"      % (float(int(perf_cnt[20][3], base=16)*float(0.00000005))))
-                print("         - clock-gate time: %Es"      % (float(int(perf_cnt[20][4], base=16)*float(0.00000005))))
-                print("         - power-gate time: %Es\n"    % (float(int(perf_cnt[20][5], base=16)*float(0.00000005))))
-
-                print("        spi\n")
-
-                print("         - active time:     %Es"      % (float(int(perf_cnt[21][3], base=16)*float(0.00000005))))
-                print("         - clock-gate time: %Es"      % (float(int(perf_cnt[21][4], base=16)*float(0.00000005))))
-                print("         - power-gate time: %Es\n"    % (float(int(perf_cnt[21][5], base=16)*float(0.00000005))))
-
-                print("    memory subsystem\n")
-
-                print("        ram bank 0\n")
-
-                print("         - active time:     %Es"      % (float(int(perf_cnt[23][3], base=16)*float(0.00000005))))
-                print("         - clock-gate time: %Es"      % (float(int(perf_cnt[23][4], base=16)*float(0.00000005))))
-                print("         - power-gate time: %Es"      % (float(int(perf_cnt[23][5], base=16)*float(0.00000005))))
-                print("         - retentive time:  %Es\n"    % (float(int(perf_cnt[23][6], base=16)*float(0.00000005))))
-
-                print("        ram bank 1\n")
-
-                print("         - active time:     %Es"      % (float(int(perf_cnt[24][3], base=16)*float(0.00000005))))
-                print("         - clock-gate time: %Es"      % (float(int(perf_cnt[24][4], base=16)*float(0.00000005))))
-                print("         - power-gate time: %Es"      % (float(int(perf_cnt[24][5], base=16)*float(0.00000005))))
-                print("         - retentive time:  %Es\n"    % (float(int(perf_cnt[24][6], base=16)*float(0.00000005))))
-
-                print("        ram bank 2\n")
-
-                print("         - active time:     %Es"      % (float(int(perf_cnt[25][3], base=16)*float(0.00000005))))
-                print("         - clock-gate time: %Es"      % (float(int(perf_cnt[25][4], base=16)*float(0.00000005))))
-                print("         - power-gate time: %Es"      % (float(int(perf_cnt[25][5], base=16)*float(0.00000005))))
-                print("         - retentive time:  %Es\n"    % (float(int(perf_cnt[25][6], base=16)*float(0.00000005))))
-
-                print("        ram bank 3\n")
-
-                print("         - active time:     %Es"      % (float(int(perf_cnt[26][3], base=16)*float(0.00000005))))
-                print("         - clock-gate time: %Es"      % (float(int(perf_cnt[26][4], base=16)*float(0.00000005))))
-                print("         - power-gate time: %Es"      % (float(int(perf_cnt[26][5], base=16)*float(0.00000005))))
-                print("         - retentive time:  %Es"      % (float(int(perf_cnt[26][6], base=16)*float(0.00000005))))
-
-                perf_estim_file.close()
-
-            perf_cnt_file.close()
-
-
-    def estimate_energy(self, cells):
-
-        with open('/home/xilinx/x-heep-femu-sdk/sw/riscv/pwr_val/TSMC_65nm_' + cells + '_20MHz.csv') as power_values_file:
-            power_values_reader = csv.reader(power_values_file, delimiter=',')
-            power_values = []
-            for row in power_values_reader:
-                power_values.append(row)
-
-            with open('/home/xilinx/x-heep-femu-sdk/sw/riscv/build/perf_estim.csv') as perf_estim_file:
-                perf_estim_reader = csv.reader(perf_estim_file, delimiter=',')
-                perf_estim = []
-                for row in perf_estim_reader:
-                    perf_estim.append(row)
-
-                               # active power                 # active time                     # leakage power                # clock-gate time                            # power-gate time                # retentive power               # retentive time
-                energy  =   (  float(power_values[2][5])  *   float(perf_estim[2][3]) )  +   (  float(power_values[2][3])  *   float(perf_estim[2][4]) )    +   ( 0   *    float(perf_estim[2][5]) )     + \
-                            (  float(power_values[3][5])  *   float(perf_estim[3][3]) )  +   (  float(power_values[3][3])  *   float(perf_estim[3][4]) )    + \
-                            (  float(power_values[4][5])  *   float(perf_estim[4][3]) )  +   (  float(power_values[4][3])  *   float(perf_estim[4][4]) )    + \
-                            (  float(power_values[6][5])  *   float(perf_estim[6][3]) )  +   (  float(power_values[6][3])  *   float(perf_estim[6][4]) )    + \
-                            (  float(power_values[7][5])  *   float(perf_estim[7][3]) )  +   (  float(power_values[7][3])  *   float(perf_estim[7][4]) )    + \
-                            (  float(power_values[8][5])  *   float(perf_estim[8][3]) )  +   (  float(power_values[8][3])  *   float(perf_estim[8][4]) )    + \
-                            (  float(power_values[9][5])  *   float(perf_estim[9][3]) )  +   (  float(power_values[9][3])  *   float(perf_estim[9][4]) )    + \
-                            ( float(power_values[10][5])  *  float(perf_estim[10][3]) )  +   ( float(power_values[10][3])  *  float(perf_estim[10][4]) )    + \
-                            ( float(power_values[11][5])  *  float(perf_estim[11][3]) )  +   ( float(power_values[11][3])  *  float(perf_estim[11][4]) )    + \
-                            ( float(power_values[12][5])  *  float(perf_estim[12][3]) )  +   ( float(power_values[12][3])  *  float(perf_estim[12][4]) )    + \
-                            ( float(power_values[13][5])  *  float(perf_estim[13][3]) )  +   ( float(power_values[13][3])  *  float(perf_estim[13][4]) )    + \
-                            ( float(power_values[14][5])  *  float(perf_estim[14][3]) )  +   ( float(power_values[14][3])  *  float(perf_estim[14][4]) )    + \
-                            ( float(power_values[15][5])  *  float(perf_estim[15][3]) )  +   ( float(power_values[15][3])  *  float(perf_estim[15][4]) )    + \
-                            ( float(power_values[17][5])  *  float(perf_estim[17][3]) )  +   ( float(power_values[17][3])  *  float(perf_estim[17][4]) )    +   ( 0   *   float(perf_estim[17][5]) )   + \
-                            ( float(power_values[18][5])  *  float(perf_estim[18][3]) )  +   ( float(power_values[18][3])  *  float(perf_estim[18][4]) )    +   ( 0   *   float(perf_estim[18][5]) )   + \
-                            ( float(power_values[19][5])  *  float(perf_estim[19][3]) )  +   ( float(power_values[19][3])  *  float(perf_estim[19][4]) )    +   ( 0   *   float(perf_estim[19][5]) )   + \
-                            ( float(power_values[20][5])  *  float(perf_estim[20][3]) )  +   ( float(power_values[20][3])  *  float(perf_estim[20][4]) )    +   ( 0   *   float(perf_estim[20][5]) )   + \
-                            ( float(power_values[21][5])  *  float(perf_estim[21][3]) )  +   ( float(power_values[21][3])  *  float(perf_estim[21][4]) )    +   ( 0   *   float(perf_estim[21][5]) )   + \
-                            ( float(power_values[23][5])  *  float(perf_estim[23][3]) )  +   ( float(power_values[23][3])  *  float(perf_estim[23][4]) )    +   ( 0   *   float(perf_estim[23][5]) )   +   ( float(power_values[23][6])  *   float(perf_estim[23][6]) ) + \
-                            ( float(power_values[24][5])  *  float(perf_estim[24][3]) )  +   ( float(power_values[24][3])  *  float(perf_estim[24][4]) )    +   ( 0   *   float(perf_estim[24][5]) )   +   ( float(power_values[24][6])  *   float(perf_estim[24][6]) ) + \
-                            ( float(power_values[25][5])  *  float(perf_estim[25][3]) )  +   ( float(power_values[25][3])  *  float(perf_estim[25][4]) )    +   ( 0   *   float(perf_estim[25][5]) )   +   ( float(power_values[25][6])  *   float(perf_estim[25][6]) ) + \
-                            ( float(power_values[26][5])  *  float(perf_estim[26][3]) )  +   ( float(power_values[26][3])  *  float(perf_estim[26][4]) )    +   ( 0   *   float(perf_estim[26][5]) )   +   ( float(power_values[26][6])  *   float(perf_estim[26][6]) ) + \
-                            \
-                            ( float(power_values[28][5])  *  float(perf_estim[28][7]) )
-
-                with open('/home/xilinx/x-heep-femu-sdk/sw/riscv/build/energy_estim.csv', mode='w') as energy_estim_file:
-                    energy_estim_writer = csv.writer(energy_estim_file, delimiter=',', quotechar='"', quoting=csv.QUOTE_MINIMAL)
-
-                    # Save energy estimation to CSV file
-                    energy_estim_writer.writerow(['module', '', '',                                                          'active energy',                                  'clock-gate energy',        'power-gate energy',                                   'retentive energy', ''])
-                    energy_estim_writer.writerow(['x-heep', '', '',                                                                       '',                                                   '',                         '',                                                   '', ''])
-                    energy_estim_writer.writerow(['', 'cpu', '',                           float(power_values[2][5])*float(perf_estim[2][3]),    float(power_values[2][3])*float(perf_estim[2][4]),  0*float(perf_estim[2][3]),                                                  '-', ''])
-                    energy_estim_writer.writerow(['', 'bus ao', '',                        float(power_values[3][5])*float(perf_estim[3][3]),    float(power_values[3][3])*float(perf_estim[3][4]),                        '-',                                                  '-', ''])
-                    energy_estim_writer.writerow(['', 'debug ao', '',                      float(power_values[4][5])*float(perf_estim[4][3]),    float(power_values[4][3])*float(perf_estim[4][4]),                        '-',                                                  '-', ''])
-                    energy_estim_writer.writerow(['', 'always-on peripheral subsystem', '',                                               '',                                                   '',                         '',                                                   '', ''])
-                    energy_estim_writer.writerow(['', '', 'soc ctrl ao',                   float(power_values[6][5])*float(perf_estim[6][3]),    float(power_values[6][3])*float(perf_estim[6][4]),                        '-',                                                  '-', ''])
-                    energy_estim_writer.writerow(['', '', 'boot rom ao',                   float(power_values[7][5])*float(perf_estim[7][3]),    float(power_values[7][3])*float(perf_estim[7][4]),                        '-',                                                  '-', ''])
-                    energy_estim_writer.writerow(['', '', 'spi flash ao',                  float(power_values[8][5])*float(perf_estim[8][3]),    float(power_values[8][3])*float(perf_estim[8][4]),                        '-',                                                  '-', ''])
-                    energy_estim_writer.writerow(['', '', 'spi ao',                        float(power_values[9][5])*float(perf_estim[9][3]),    float(power_values[9][3])*float(perf_estim[9][4]),                        '-',                                                  '-', ''])
-                    energy_estim_writer.writerow(['', '', 'power manager ao',             float(power_values[10][5])*float(perf_estim[10][3]),  float(power_values[10][3])*float(perf_estim[10][4]),                        '-',                                                 '-', ''])
-                    energy_estim_writer.writerow(['', '', 'timer ao',                     float(power_values[11][5])*float(perf_estim[11][3]),  float(power_values[11][3])*float(perf_estim[11][4]),                        '-',                                                 '-', ''])
-                    energy_estim_writer.writerow(['', '', 'dma ao',                       float(power_values[12][5])*float(perf_estim[12][3]),  float(power_values[12][3])*float(perf_estim[12][4]),                        '-',                                                 '-', ''])
-                    energy_estim_writer.writerow(['', '', 'fast int ctrl ao',             float(power_values[13][5])*float(perf_estim[13][3]),  float(power_values[13][3])*float(perf_estim[13][4]),                        '-',                                                 '-', ''])
-                    energy_estim_writer.writerow(['', '', 'gpio ao',                      float(power_values[14][5])*float(perf_estim[14][3]),  float(power_values[14][3])*float(perf_estim[14][4]),                        '-',                                                 '-', ''])
-                    energy_estim_writer.writerow(['', '', 'uart ao',                      float(power_values[15][5])*float(perf_estim[15][3]),  float(power_values[15][3])*float(perf_estim[15][4]),                        '-',                                                 '-', ''])
-                    energy_estim_writer.writerow(['', 'peripheral subsystem', '',                                                          '',                                                   '',                         '',                                                  '', ''])
-                    energy_estim_writer.writerow(['', '', 'plic',                         float(power_values[17][5])*float(perf_estim[17][3]),  float(power_values[17][3])*float(perf_estim[17][4]), 0*float(perf_estim[17][5]),                                                 '-', ''])
-                    energy_estim_writer.writerow(['', '', 'gpio',                         float(power_values[18][5])*float(perf_estim[18][3]),  float(power_values[18][3])*float(perf_estim[18][4]), 0*float(perf_estim[18][5]),                                                 '-', ''])
-                    energy_estim_writer.writerow(['', '', 'i2c',                          float(power_values[19][5])*float(perf_estim[19][3]),  float(power_values[19][3])*float(perf_estim[19][4]), 0*float(perf_estim[19][5]),                                                 '-', ''])
-                    energy_estim_writer.writerow(['', '', 'timer',                        float(power_values[20][5])*float(perf_estim[20][3]),  float(power_values[20][3])*float(perf_estim[20][4]), 0*float(perf_estim[20][5]),                                                 '-', ''])
-                    energy_estim_writer.writerow(['', '', 'spi',                          float(power_values[21][5])*float(perf_estim[21][3]),  float(power_values[21][3])*float(perf_estim[21][4]), 0*float(perf_estim[21][5]),                                                 '-', ''])
-                    energy_estim_writer.writerow(['', 'memory subsystem', '',                                                              '',                                                   '',                         '',                                                  '', ''])
-                    energy_estim_writer.writerow(['', '', 'ram bank 0',                   float(power_values[23][5])*float(perf_estim[23][3]),  float(power_values[23][3])*float(perf_estim[23][4]), 0*float(perf_estim[23][5]), float(power_values[23][6])*float(perf_estim[23][6]), ''])
-                    energy_estim_writer.writerow(['', '', 'ram bank 1',                   float(power_values[24][5])*float(perf_estim[24][3]),  float(power_values[24][3])*float(perf_estim[24][4]), 0*float(perf_estim[24][5]), float(power_values[24][6])*float(perf_estim[24][6]), ''])
-                    energy_estim_writer.writerow(['', '', 'ram bank 2',                   float(power_values[25][5])*float(perf_estim[25][3]),  float(power_values[25][3])*float(perf_estim[25][4]), 0*float(perf_estim[25][5]), float(power_values[25][6])*float(perf_estim[25][6]), ''])
-                    energy_estim_writer.writerow(['', '', 'ram bank 3',                   float(power_values[26][5])*float(perf_estim[26][3]),  float(power_values[26][3])*float(perf_estim[26][4]), 0*float(perf_estim[26][5]), float(power_values[26][6])*float(perf_estim[26][6]), ''])
-                    energy_estim_writer.writerow(['', '', '', '', '', '', '', ''])
-                    energy_estim_writer.writerow(['Total energy', '', '', '', '', '', '', energy])
-
-                    # Print energy estimation to stdout
-                    print("\n--- ENERGY ESTIMATION AT 20MHz ---\n")
-
-                    print("total energy:                 %EJ\n"    % (energy))
-
-                    print("x-heep\n")
-
-                    print("    cpu\n")
-
-                    print("     - active energy:         %EJ"      % (float(power_values[2][5])*float(perf_estim[2][3])))
-                    print("     - clock-gate energy:     %EJ"      % (float(power_values[2][3])*float(perf_estim[2][4])))
-                    print("     - power-gate energy:     %EJ\n"    % (0*float(perf_estim[2][3])))
-
-                    print("    bus ao\n")
-
-                    print("     - active energy:         %EJ"      % (float(power_values[3][5])*float(perf_estim[3][3])))
-                    print("     - clock-gate energy:     %EJ\n"    % (float(power_values[3][3])*float(perf_estim[3][4])))
-
-                    print("    debug ao\n")
-
-                    print("     - active energy:         %EJ"      % (float(power_values[4][5])*float(perf_estim[4][3])))
-                    print("     - clock-gate energy:     %EJ\n"    % (float(power_values[4][3])*float(perf_estim[4][4])))
-
-                    print("    always-on peripheral subsystem\n")
-
-                    print("        soc ctrl ao\n")
-
-                    print("         - active energy:     %EJ"      % (float(power_values[6][5])*float(perf_estim[6][3])))
-                    print("         - clock-gate energy: %EJ\n"    % (float(power_values[6][3])*float(perf_estim[6][4])))
-
-                    print("        boot rom ao\n")
-
-                    print("         - active energy:     %EJ"      % (float(power_values[7][5])*float(perf_estim[7][3])))
-                    print("         - clock-gate energy: %EJ\n"    % (float(power_values[7][3])*float(perf_estim[7][4])))
-
-                    print("        spi flash ao\n")
-
-                    print("         - active energy:     %EJ"      % (float(power_values[8][5])*float(perf_estim[8][3])))
-                    print("         - clock-gate energy: %EJ\n"    % (float(power_values[8][3])*float(perf_estim[8][4])))
-
-                    print("        spi ao\n")
-
-                    print("         - active energy:     %EJ"      % (float(power_values[9][5])*float(perf_estim[9][3])))
-                    print("         - clock-gate energy: %EJ\n"    % (float(power_values[9][3])*float(perf_estim[9][4])))
-
-                    print("        power manager ao\n")
-
-                    print("         - active energy:     %EJ"      % (float(power_values[10][5])*float(perf_estim[10][3])))
-                    print("         - clock-gate energy: %EJ\n"    % (float(power_values[10][3])*float(perf_estim[10][4])))
-
-                    print("        timer ao\n")
+        snapshot = self.snapshot_perf_cnt(perf_cnt)
+        self.write_perf_cnt_csv('/home/xilinx/x-heep-femu-sdk/sw/riscv/build/perf_cnt.csv', 'cycles', self.perf_cnt_table(snapshot),
+                                'Total cycles', snapshot[PERF_CNT_TOTAL], lambda cycles: hex(int(cycles)))
+        return snapshot
 
-                    print("         - active energy:     %EJ"      % (float(power_values[11][5])*float(perf_estim[11][3])))
-                    print("         - clock-gate energy: %EJ\n"    % (float(power_values[11][3])*float(perf_estim[11][4])))
 
-                    print("        dma ao\n")
+    def estimate_performance(self, clk_freq_hz=PERF_CNT_CLK_FREQ_HZ):
 
-                    print("         - active energy:     %EJ"      % (float(power_values[12][5])*float(perf_estim[12][3])))
-                    print("         - clock-gate energy: %EJ\n"    % (float(power_values[12][3])*float(perf_estim[12][4])))
+        metrics = self.perf_cnt_metrics(self.read_perf_cnt_csv(), clk_freq_hz)
+        times = metrics['times']
 
-                    print("        fast int ctrl ao\n")
+        # Save performance estimation to CSV file
+        self.write_perf_cnt_csv('/home/xilinx/x-heep-femu-sdk/sw/riscv/build/perf_estim.csv', 'cycles', times,
+                                'Total time', metrics['total time'], float)
 
-                    print("         - active energy:     %EJ"      % (float(power_values[13][5])*float(perf_estim[13][3])))
-                    print("         - clock-gate energy: %EJ\n"    % (float(power_values[13][3])*float(perf_estim[13][4])))
+        # Print performance estimation to stdout
+        self.print_perf_cnt_report("PERFORMANCE ESTIMATION AT %gMHz" % (clk_freq_hz / 1e6), times, metrics['total time'], "time", "s")
 
-                    print("        gpio ao\n")
+        return metrics
 
-                    print("         - active energy:     %EJ"      % (float(power_values[14][5])*float(perf_estim[14][3])))
-                    print("         - clock-gate energy: %EJ\n"    % (float(power_values[14][3])*float(perf_estim[14][4])))
 
-                    print("        uart ao\n")
+    def print_perf_cnt_report(self, title, table, total, quantity, unit):
 
-                    print("         - active energy:     %EJ"      % (float(power_values[15][5])*float(perf_estim[15][3])))
-                    print("         - clock-gate energy: %EJ\n"    % (float(power_values[15][3])*float(perf_estim[15][4])))
+        # Print a per-module table in the layout of the estimation reports
+        print("\n--- " + title + " ---\n")
 
-                    print("    peripheral subsystem\n")
+        print(("total " + quantity + ":").ljust(24 + len(quantity)) + "%E" % total + unit + "\n")
 
-                    print("        plic\n")
+        print("x-heep\n")
 
-                    print("         - active energy:     %EJ"      % (float(power_values[17][5])*float(perf_estim[17][3])))
-                    print("         - clock-gate energy: %EJ"      % (float(power_values[17][3])*float(perf_estim[17][4])))
-                    print("         - power-gate energy: %EJ\n"    % (                         0*float(perf_estim[17][5])))
+        subsystem = ''
+        for row in table:
+            if row['subsystem'] != subsystem:
+                subsystem = row['subsystem']
+                print("    " + subsystem + "\n")
+            indent = "        " if subsystem else "    "
+            print(indent + row['module'] + "\n")
+            states = [state for state in PERF_CNT_STATES if not np.isnan(row[state])]
+            for i, state in enumerate(states):
+                label = (state + " " + quantity + ":").ljust((17 if subsystem else 21) + len(quantity) - 4)
+                print(indent + " - " + label + "%E" % row[state] + unit + ("\n" if i == len(states) - 1 else ""))
 
-                    print("        gpio\n")
 
-                    print("         - active energy:     %EJ"      % (float(power_values[18][5])*float(perf_estim[18][3])))
-                    print("         - clock-gate energy: %EJ"      % (float(power_values[18][3])*float(perf_estim[18][4])))
-                    print("         - power-gate energy: %EJ\n"    % (                         0*float(perf_estim[18][5])))
+    def load_power_table(self, file_name):
 
-                    print("        i2c\n")
+        # Read a power table into {module: (leakage, dynamic, total, retentive)}, '-' read as 0
+        power = {}
+        with open(file_name) as power_values_file:
+            for row in csv.reader(power_values_file, delimiter=','):
+                name = row[2] or row[1] or row[0]
+                if name == 'module' or len(row) < 6 or row[3] == '':
+                    continue
+                power[name] = tuple(0.0 if value in ('', '-') else float(value) for value in (row[3:7] + [''] * 4)[:4])
+        return power
 
-                    print("         - active energy:     %EJ"      % (float(power_values[19][5])*float(perf_estim[19][3])))
-                    print("         - clock-gate energy: %EJ"      % (float(power_values[19][3])*float(perf_estim[19][4])))
-                    print("         - power-gate energy: %EJ\n"    % (                         0*float(perf_estim[19][5])))
 
-                    print("        timer\n")
+    def power_model(self, cells, clk_freq_hz=PERF_CNT_CLK_FREQ_HZ):
 
-                    print("         - active energy:     %EJ"      % (float(power_values[20][5])*float(perf_estim[20][3])))
-                    print("         - clock-gate energy: %EJ"      % (float(power_values[20][3])*float(perf_estim[20][4])))
-                    print("         - power-gate energy: %EJ\n"    % (                         0*float(perf_estim[20][5])))
+        # Power drawn by each module of PERF_CNT_MAP in each counter state at clk_freq_hz,
+        # from the table of the cell library characterized closest to that frequency.
+        # Dynamic power is scaled linearly with the frequency; clock-gated modules only
+        # leak and power-gated modules draw nothing. Modules missing from the table
+        # contribute nothing.
+        tables = {}
+        for file_name in glob.glob(PWR_VAL_DIR + "TSMC_65nm_" + cells + "_*MHz.csv"):
+            match = re.search(r"_([0-9.]+)MHz\.csv$", file_name)
+            if match:
+                tables[float(match.group(1)) * 1e6] = file_name
+        if not tables:
+            raise FileNotFoundError("no power table for " + cells + " cells in " + PWR_VAL_DIR)
+        ref_freq_hz = min(tables, key=lambda freq: abs(freq - clk_freq_hz))
+        power = self.load_power_table(tables[ref_freq_hz])
+        scale = clk_freq_hz / ref_freq_hz
 
-                    print("        spi\n")
+        states = np.zeros((len(PERF_CNT_MAP), len(PERF_CNT_STATES)))
+        for i, (subsystem, module, words) in enumerate(PERF_CNT_MAP):
+            leakage, dynamic, total, retentive = power.get(module, (0.0, 0.0, 0.0, 0.0))
+            states[i] = (total + dynamic * (scale - 1), leakage, 0.0, retentive)
+        leakage, dynamic, total, retentive = power.get('external', (0.0, 0.0, 0.0, 0.0))
+        return {'states': states, 'external': total + dynamic * (scale - 1)}
 
-                    print("         - active energy:     %EJ"      % (float(power_values[21][5])*float(perf_estim[21][3])))
-                    print("         - clock-gate energy: %EJ"      % (float(power_values[21][3])*float(perf_estim[21][4])))
-                    print("         - power-gate energy: %EJ\n"    % (                         0*float(perf_estim[21][5])))
 
-                    print("    memory subsystem\n")
+    def energy_from_snapshots(self, snapshots, model, clk_freq_hz=PERF_CNT_CLK_FREQ_HZ):
 
-                    print("        ram bank 0\n")
+        # Evaluate the energy of one snapshot or a stack of snapshots (one per row) in a
+        # single pass. Returns per-module, per-state energy, the energy of the modules
+        # outside the counters and the total, each with one entry per snapshot.
+        snapshots = np.atleast_2d(snapshots)
+        times = snapshots[:, np.maximum(PERF_CNT_INDEX, 0)] * PERF_CNT_PRESENT / clk_freq_hz
+        energy = times * model['states']
+        external = snapshots[:, PERF_CNT_TOTAL] / clk_freq_hz * model['external']
+        return {'modules': energy, 'external': external, 'total': energy.sum(axis=(1, 2)) + external}
 
-                    print("         - active energy:     %EJ"      % (float(power_values[23][5])*float(perf_estim[23][3])))
-                    print("         - clock-gate energy: %EJ"      % (float(power_values[23][3])*float(perf_estim[23][4])))
-                    print("         - power-gate energy: %EJ"      % (                         0*float(perf_estim[23][5])))
-                    print("         - retentive energy:  %EJ\n"    % (float(power_values[23][6])*float(perf_estim[23][6])))
 
-                    print("        ram bank 1\n")
+    def sweep_energy(self, snapshots, cells_list, clk_freq_hz_list):
 
-                    print("         - active energy:     %EJ"      % (float(power_values[24][5])*float(perf_estim[24][3])))
-                    print("         - clock-gate energy: %EJ"      % (float(power_values[24][3])*float(perf_estim[24][4])))
-                    print("         - power-gate energy: %EJ"      % (                         0*float(perf_estim[24][5])))
-                    print("         - retentive energy:  %EJ\n"    % (float(power_values[24][6])*float(perf_estim[24][6])))
+        # Total energy of every snapshot for every cell library and clock frequency,
+        # keyed by (cells, clk_freq_hz). Snapshots hold cycle counts, so the runs are
+        # assumed to take the same number of cycles at every frequency.
+        return {(cells, clk_freq_hz): self.energy_from_snapshots(snapshots, self.power_model(cells, clk_freq_hz), clk_freq_hz)['total']
+                for cells in cells_list for clk_freq_hz in clk_freq_hz_list}
 
-                    print("        ram bank 2\n")
 
-                    print("         - active energy:     %EJ"      % (float(power_values[25][5])*float(perf_estim[25][3])))
-                    print("         - clock-gate energy: %EJ"      % (float(power_values[25][3])*float(perf_estim[25][4])))
-                    print("         - power-gate energy: %EJ"      % (                         0*float(perf_estim[25][5])))
-                    print("         - retentive energy:  %EJ\n"    % (float(power_values[25][6])*float(perf_estim[25][6])))
+    def estimate_energy(self, cells, clk_freq_hz=PERF_CNT_CLK_FREQ_HZ):
 
-                    print("        ram bank 3\n")
+        snapshot = self.read_perf_cnt_csv()
+        energy = self.energy_from_snapshots(snapshot, self.power_model(cells, clk_freq_hz), clk_freq_hz)
 
-                    print("         - active energy:     %EJ"      % (float(power_values[26][5])*float(perf_estim[26][3])))
-                    print("         - clock-gate energy: %EJ"      % (float(power_values[26][3])*float(perf_estim[26][4])))
-                    print("         - power-gate energy: %EJ"      % (                         0*float(perf_estim[26][5])))
-                    print("         - retentive energy:  %EJ"      % (float(power_values[26][6])*float(perf_estim[26][6])))
+        table = self.perf_cnt_table(snapshot)
+        for i, state in enumerate(PERF_CNT_STATES):
+            table[state] = np.where(PERF_CNT_PRESENT[:, i], energy['modules'][0, :, i], np.nan)
 
-                    energy_estim_file.close()
+        # Save energy estimation to CSV file
+        self.write_perf_cnt_csv('/home/xilinx/x-heep-femu-sdk/sw/riscv/build/energy_estim.csv', 'energy', table,
+                                'Total energy', energy['total'][0], float)
 
-                perf_estim_file.close()
+        # Print energy estimation to stdout
+        self.print_perf_cnt_report("ENERGY ESTIMATION AT %gMHz" % (clk_freq_hz / 1e6), table, energy['total'][0], "energy", "J")
 
-            power_values_file.close()
+        return energy
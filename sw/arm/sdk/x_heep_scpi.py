@@ -0,0 +1,283 @@
+# Copyright 2023 EPFL
+# Solderpad Hardware License, Version 2.1, see LICENSE.md for details.
+# SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+
+import collections
+import time
+import numpy as np
+import serial
+
+SCPI_UART_PORT        = "/dev/ttyPS1"
+SCPI_UART_BAUDRATE    = 115200
+
+# The U-mode loop of tflite_scpi reads lines of at most 2047 bytes. A raw
+# chunk escapes to at most twice its size, plus the command header.
+SCPI_LINE_CHUNK_SIZE  = 960
+
+# Generated header picked up by the tflite_scpi Makefile, see calibrate_arena()
+SCPI_ARENA_HEADER     = "/home/xilinx/x-heep-femu-sdk/sw/riscv/apps/tflite_scpi/models/lenet5_arena.h"
+
+
+class XHeepScpiError(Exception):
+    pass
+
+
+class XHeepScpiClient:
+
+    # Client for the tflite_scpi inference server on the X-HEEP UART.
+    #
+    # Requests are NN:INFEr:DATA? queries carrying the input tensor as a
+    # definite-length block; scores come back as int8 blocks (FORMat:DATA
+    # INT8). Up to `window` requests are kept in flight and responses are
+    # matched to requests in order. Any other line printed by the firmware is
+    # collected in `console`.
+    #
+    # The firmware echo is switched off (SYSTem:ECHO OFF) before anything
+    # else: echoed payload bytes would otherwise be parsed as responses.
+    #
+    # Inputs longer than one line are streamed across lines into the input
+    # tensor, so submit() rejects inputs larger than it (NN:INPut:SIZE?).
+    #
+    # Responses carry no request id. After an error line, which fails the
+    # oldest pending request, the client sends *OPC? and sets aside everything
+    # received up to its reply: if that matches the requests still in flight
+    # one to one they are completed in order, otherwise they all fail instead
+    # of being paired with the wrong response.
+
+    def __init__(self, port=SCPI_UART_PORT, baudrate=SCPI_UART_BAUDRATE, window=1, timeout=10.0):
+
+        self.uart = serial.Serial(port, baudrate, timeout=0.05)
+        self.window = window
+        self.timeout = timeout
+        self.console = []
+        self.rx = bytearray()
+        self.next_id = 0
+        self.pending = collections.deque()
+        self.results = {}
+        self.resync = None
+
+        self.uart.reset_input_buffer()
+        self.write_line(b"SYST:ECHO OFF")
+        self.write_line(b"FORM:DATA INT8")
+
+        # The firmware may still echo the lines above, read before it parsed
+        # the first one; the response to the query comes after all of them
+        if self.query("FORM:DATA?", skip=("SYST:ECHO OFF", "FORM:DATA INT8")) != "INT8":
+            raise XHeepScpiError("could not select the INT8 result format")
+        self.input_size = int(self.query("NN:INP:SIZE?"))
+
+
+    def __enter__(self):
+
+        return self
+
+
+    def __exit__(self, *args):
+
+        self.close()
+
+
+    def close(self):
+
+        self.uart.close()
+
+
+    def escape(self, data):
+
+        # The firmware line reader takes the byte after a backslash literally
+        return data.replace(b"\\", b"\\\\").replace(b"\n", b"\\\n").replace(b"\r", b"\\\r")
+
+
+    def write_line(self, line):
+
+        self.uart.write(line + b"\n")
+
+
+    def submit(self, data):
+
+        # Send one inference request and return its id, without waiting for the
+        # response unless the pipeline window is full
+        payload = np.ascontiguousarray(data).view(np.uint8).tobytes()
+        if len(payload) > self.input_size:
+            raise XHeepScpiError("input of " + str(len(payload)) + " bytes exceeds the " +
+                                 str(self.input_size) + " byte input tensor")
+        length = str(len(payload)).encode()
+        header = b"NN:INFE:DATA? #" + str(len(length)).encode() + length
+
+        while len(self.pending) >= self.window:
+            self.receive()
+
+        request_id = self.next_id
+        self.next_id += 1
+        self.pending.append(request_id)
+
+        first = payload[:SCPI_LINE_CHUNK_SIZE]
+        self.write_line(header + self.escape(first))
+        for offset in range(len(first), len(payload), SCPI_LINE_CHUNK_SIZE):
+            self.write_line(self.escape(payload[offset:offset + SCPI_LINE_CHUNK_SIZE]))
+
+        return request_id
+
+
+    def result(self, request_id):
+
+        # Wait for the response to `request_id`; returns the int8 scores or
+        # raises XHeepScpiError if the server reported an error
+        while request_id not in self.results:
+            if request_id not in self.pending:
+                raise KeyError(request_id)
+            self.receive()
+        result = self.results.pop(request_id)
+        if isinstance(result, XHeepScpiError):
+            raise result
+        return result
+
+
+    def infer(self, data):
+
+        return self.result(self.submit(data))
+
+
+    def infer_many(self, inputs):
+
+        # Pipeline a sequence of inputs, yielding the scores in input order
+        in_flight = collections.deque()
+        for data in inputs:
+            in_flight.append(self.submit(data))
+            while len(in_flight) >= self.window:
+                yield self.result(in_flight.popleft())
+        while in_flight:
+            yield self.result(in_flight.popleft())
+
+
+    def query(self, command, skip=()):
+
+        # Send a query answered by one text line and return that line; requests
+        # still in flight are completed first. Lines in `skip` are ignored.
+        while self.pending or self.resync is not None:
+            self.receive()
+        self.write_line(command.encode())
+
+        deadline = time.monotonic() + self.timeout
+        while True:
+            newline = self.rx.find(b"\n")
+            if newline < 0:
+                if time.monotonic() > deadline:
+                    raise TimeoutError("no SCPI response within " + str(self.timeout) + " s")
+                self.rx += self.uart.read(max(1, self.uart.in_waiting))
+                continue
+            line = bytes(self.rx[:newline]).strip(b"\r").decode(errors="replace")
+            del self.rx[:newline + 1]
+            # Skip blank lines and the firmware echo of the command
+            if line == "" or line == command or line in skip:
+                continue
+            if line == "ERR!" or line.startswith('"'):
+                raise XHeepScpiError(line.strip('"'))
+            return line
+
+
+    def calibrate_arena(self, header_file=SCPI_ARENA_HEADER):
+
+        # Measure the tensor arena the model needs (NN:ARENa:CALibrate?) and,
+        # unless header_file is None, write it for the next build of tflite_scpi
+        required, persistent, nonpersistent, size = (int(v) for v in self.query("NN:AREN:CAL?").split(","))
+
+        if header_file is not None:
+            with open(header_file, "w") as f:
+                f.write("// Generated by XHeepScpiClient.calibrate_arena(), delete to use the default\n")
+                f.write("// arena size. Persistent " + str(persistent) + " B, non-persistent " + str(nonpersistent) + " B,\n")
+                f.write("// measured with a " + str(size) + " B arena.\n")
+                f.write("#ifndef LENET5_ARENA_H\n")
+                f.write("#define LENET5_ARENA_H\n")
+                f.write("#define TFLITE_ARENA_SIZE " + str(required) + "\n")
+                f.write("#endif\n")
+
+        return {"required": required, "persistent": persistent, "nonpersistent": nonpersistent, "size": size}
+
+
+    def receive(self):
+
+        # Read from the UART until at least one response has been matched
+        deadline = time.monotonic() + self.timeout
+        while not self.parse():
+            if time.monotonic() > deadline:
+                raise TimeoutError("no SCPI response within " + str(self.timeout) + " s")
+            self.rx += self.uart.read(max(1, self.uart.in_waiting))
+
+
+    def complete(self, result):
+
+        if self.resync is not None:
+            self.resync["responses"].append(result)
+            return
+        if not self.pending:
+            self.console.append(result if isinstance(result, str) else repr(result))
+            return
+        self.results[self.pending.popleft()] = result
+
+
+    def fail(self, error):
+
+        # Complete the oldest pending request with `error`, then resynchronize
+        # on *OPC? before matching further responses
+        if self.resync is not None:
+            self.resync["responses"].append(error)
+            return
+        self.complete(error)
+        self.write_line(b"*OPC?")
+        self.resync = {"requests": len(self.pending), "responses": []}
+
+
+    def resynced(self):
+
+        # *OPC? answered: everything sent before it has been responded to
+        requests = [self.pending.popleft() for _ in range(self.resync["requests"])]
+        responses = self.resync["responses"]
+        self.resync = None
+        if len(responses) != len(requests):
+            responses = [XHeepScpiError("response lost after an earlier error")] * len(requests)
+        for request_id, result in zip(requests, responses):
+            self.results[request_id] = result
+
+
+    def parse(self):
+
+        # Consume complete lines and blocks from the receive buffer, return True
+        # once a response was matched
+        matched = False
+        while True:
+            start = 0
+            while start < len(self.rx) and self.rx[start] in b"\r\n":
+                start += 1
+            del self.rx[:start]
+
+            if self.rx[:1] == b"#":
+                if len(self.rx) < 2:
+                    return matched
+                digits = self.rx[1] - ord("0")
+                if digits < 1 or digits > 9:
+                    raise XHeepScpiError("indefinite or malformed block header")
+                if len(self.rx) < 2 + digits:
+                    return matched
+                length = int(self.rx[2:2 + digits])
+                end = 2 + digits + length
+                if len(self.rx) < end:
+                    return matched
+                self.complete(np.frombuffer(bytes(self.rx[2 + digits:end]), dtype=np.int8))
+                del self.rx[:end]
+                matched = True
+                continue
+
+            newline = self.rx.find(b"\n")
+            if newline < 0:
+                return matched
+            line = bytes(self.rx[:newline]).strip(b"\r").decode(errors="replace")
+            del self.rx[:newline + 1]
+            if line == "ERR!" or line.startswith('"'):
+                matched = matched or self.resync is None
+                self.fail(XHeepScpiError(line.strip('"')))
+            elif line == "1" and self.resync is not None:
+                self.resynced()
+                matched = True
+            else:
+                self.console.append(line)
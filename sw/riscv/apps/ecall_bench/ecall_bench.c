@@ -0,0 +1,219 @@
+// Copyright EPFL contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+// Measures the round trip of a U-mode ecall: drop to U-mode, issue
+// ECALL_BENCH_ITERATIONS calls to an empty system call between two timestamp
+// calls, and report the cycles per call with the cost of a lone timestamp call
+// subtracted. The loop runs twice, first through syscall_entry and then, with
+// mtvec pointing at bench_legacy_vectors, through a C dispatcher doing the
+// work of the handler_exception path that syscall_entry replaced.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "csr.h"
+#include "handler.h"
+#include "perf_stats.h"
+
+#define ECALL_BENCH_ITERATIONS 1000
+
+enum {
+  kBenchSysNull      = 0,
+  kBenchSysTimestamp = 1,
+  kBenchSysReport    = 2,
+  kBenchSysLegacy    = 3,
+};
+
+typedef struct bench_result {
+  uint32_t cycles;
+  uint32_t overhead;
+} bench_result_t;
+
+static uint32_t user_stack[256] __attribute__((aligned(16)));
+
+// Written by U-mode, printed by bench_sys_report()
+static bench_result_t bench_results[2];
+
+// The legacy dispatcher returns through its epilogue, which restores a0, so
+// its results are handed back here instead
+static volatile uint32_t bench_legacy_ret;
+static volatile uint32_t bench_legacy = 0;
+
+static uint32_t bench_sys_null(uintptr_t arg0, uint32_t arg1) {
+  return arg0;
+}
+
+static uint32_t bench_sys_timestamp(uintptr_t arg0, uint32_t arg1) {
+  perf_counters_t now;
+  perf_counters_read(&now);
+  return (uint32_t)now.cycles;
+}
+
+static uint32_t bench_sys_report(uintptr_t arg0, uint32_t arg1) {
+  static const char *const paths[] = {"syscall_entry", "C dispatcher"};
+  for (uint32_t i = 0; i < 2; ++i) {
+    printf("ecall round trip (%s): %u cycles (%u calls, %u cycles timestamp overhead)\n\r",
+           paths[i],
+           (unsigned)((bench_results[i].cycles - bench_results[i].overhead) /
+                      ECALL_BENCH_ITERATIONS),
+           (unsigned)ECALL_BENCH_ITERATIONS, (unsigned)bench_results[i].overhead);
+  }
+  exit(EXIT_SUCCESS);
+}
+
+// Exceptions enter at the base of a vectored mtvec, which must be aligned
+__asm__(
+    ".section .text.bench_legacy_vectors, \"ax\"\n"
+    ".balign 256\n"
+    "bench_legacy_vectors:\n"
+    "  j bench_legacy_exception\n"
+    ".previous\n");
+extern const uint32_t bench_legacy_vectors[];
+extern const uint32_t __vector_start[];
+
+// Switch ecalls to the legacy dispatcher (arg0 != 0) or back to syscall_entry
+static uint32_t bench_sys_legacy(uintptr_t arg0, uint32_t arg1) {
+  bench_legacy = arg0 != 0;
+  const uint32_t *vectors = bench_legacy ? bench_legacy_vectors : __vector_start;
+  CSR_WRITE(CSR_REG_MTVEC, (uint32_t)(uintptr_t)vectors | 1);
+  return 0;
+}
+
+HANDLER_SYSCALL_TABLE(
+  [kBenchSysNull]      = bench_sys_null,
+  [kBenchSysTimestamp] = bench_sys_timestamp,
+  [kBenchSysReport]    = bench_sys_report,
+  [kBenchSysLegacy]    = bench_sys_legacy,
+);
+
+// What handler_exception did for uECall before syscall_entry: an interrupt-ABI
+// entry saving the caller-saved registers, a0/a1/a7 read with inline asm, a
+// switch on the id, ra/gp/tp/s0-s11 spilled and reloaded around the call and
+// the ecall width decoded from the instruction at mepc. Its final mret from
+// inside the function, which skipped the epilogue, is a plain return here.
+static uint32_t bench_legacy_spill[15];
+
+__attribute__((interrupt, aligned(4), used))
+void bench_legacy_exception(void) {
+  uint32_t id, arg0, arg1;
+  __asm__ volatile("mv %0, a0\n"
+                   "mv %1, a1\n"
+                   "mv %2, a7\n"
+                   : "=r"(arg0), "=r"(arg1), "=r"(id));
+
+  uint32_t mcause;
+  CSR_READ(CSR_REG_MCAUSE, &mcause);
+  if ((mcause & kIdMax) != uECall) {
+    while (1) {
+    }
+  }
+
+  __asm__ volatile(
+      "sw ra,  0(%0)\n  sw gp,  4(%0)\n  sw tp,  8(%0)\n"
+      "sw s0, 12(%0)\n  sw s1, 16(%0)\n  sw s2, 20(%0)\n"
+      "sw s3, 24(%0)\n  sw s4, 28(%0)\n  sw s5, 32(%0)\n"
+      "sw s6, 36(%0)\n  sw s7, 40(%0)\n  sw s8, 44(%0)\n"
+      "sw s9, 48(%0)\n  sw s10, 52(%0)\n sw s11, 56(%0)\n"
+      :
+      : "r"(bench_legacy_spill)
+      : "memory");
+
+  uint32_t ret;
+  switch (id) {
+    case kBenchSysNull:
+      ret = bench_sys_null(arg0, arg1);
+      break;
+    case kBenchSysTimestamp:
+      ret = bench_sys_timestamp(arg0, arg1);
+      break;
+    case kBenchSysReport:
+      ret = bench_sys_report(arg0, arg1);
+      break;
+    case kBenchSysLegacy:
+      ret = bench_sys_legacy(arg0, arg1);
+      break;
+    default:
+      ret = handler_syscall_unknown(id);
+      break;
+  }
+
+  // Reloaded into a scratch register: the cost, without undoing the compiler
+  __asm__ volatile(
+      "lw t0,  0(%0)\n  lw t0,  4(%0)\n  lw t0,  8(%0)\n"
+      "lw t0, 12(%0)\n  lw t0, 16(%0)\n  lw t0, 20(%0)\n"
+      "lw t0, 24(%0)\n  lw t0, 28(%0)\n  lw t0, 32(%0)\n"
+      "lw t0, 36(%0)\n  lw t0, 40(%0)\n  lw t0, 44(%0)\n"
+      "lw t0, 48(%0)\n  lw t0, 52(%0)\n  lw t0, 56(%0)\n"
+      :
+      : "r"(bench_legacy_spill)
+      : "t0", "memory");
+
+  uint32_t mepc;
+  CSR_READ(CSR_REG_MEPC, &mepc);
+  uint16_t instr = *(const uint16_t *)(uintptr_t)mepc;
+  mepc += (instr & 0x3) == 0x3 ? 4 : 2;
+  CSR_WRITE(CSR_REG_MEPC, mepc);
+
+  bench_legacy_ret = ret;
+}
+
+static inline uint32_t bench_ecall(uint32_t id, uint32_t arg0, uint32_t arg1) {
+  register uint32_t a7 __asm__("a7") = id;
+  register uint32_t a0 __asm__("a0") = arg0;
+  register uint32_t a1 __asm__("a1") = arg1;
+  __asm__ volatile("ecall" : "+r"(a0) : "r"(a7), "r"(a1) : "memory");
+  return a0;
+}
+
+static inline uint32_t bench_timestamp(void) {
+  uint32_t ret = bench_ecall(kBenchSysTimestamp, 0, 0);
+  return bench_legacy ? bench_legacy_ret : ret;
+}
+
+static void bench_run(bench_result_t *result) {
+  uint32_t start = bench_timestamp();
+  for (uint32_t i = 0; i < ECALL_BENCH_ITERATIONS; ++i) {
+    bench_ecall(kBenchSysNull, i, 0);
+  }
+  result->cycles = bench_timestamp() - start;
+
+  start = bench_timestamp();
+  result->overhead = bench_timestamp() - start;
+}
+
+static void __attribute__((noreturn, noinline)) user_main(void) {
+  bench_run(&bench_results[0]);
+  bench_ecall(kBenchSysLegacy, 1, 0);
+  bench_run(&bench_results[1]);
+  // Report from syscall_entry, on the M-mode stack
+  bench_ecall(kBenchSysLegacy, 0, 0);
+
+  bench_ecall(kBenchSysReport, 0, 0);
+  while (1) {
+  }
+}
+
+int main(int argc, char *argv[]) {
+  // Give U-mode access to the whole address space: one NAPOT region with RWX
+  uint32_t pmpaddr = 0xFFFFFFFF;
+  uint32_t pmpcfg = 0x1F;
+  CSR_WRITE(CSR_REG_PMPADDR0, pmpaddr);
+  CSR_WRITE(CSR_REG_PMPCFG0, pmpcfg);
+
+  // Syscalls run on the M-mode stack from its top, main() is not returned to
+  extern uint8_t _sp;
+  CSR_WRITE(CSR_REG_MSCRATCH, (uint32_t)(uintptr_t)&_sp);
+
+  // Enter user_main in U-mode (MPP = 0) on its own stack
+  uint32_t mpp = 3 << 11;
+  CSR_CLEAR_BITS(CSR_REG_MSTATUS, mpp);
+  CSR_WRITE(CSR_REG_MEPC, (uint32_t)(uintptr_t)user_main);
+  __asm__ volatile(
+      "mv sp, %0\n"
+      "mret\n"
+      :
+      : "r"(user_stack + sizeof(user_stack) / sizeof(user_stack[0])));
+
+  return EXIT_SUCCESS;
+}
@@ -18,8 +18,11 @@ extern "C" {
   #include <math.h>
   #include <stdio.h>
   #include "core_v_mini_mcu.h"
+  #include "perf_stats.h"
 }
 
+#include <new>
+
 #include "models/lenet5_input.h"
 //#include "models/lenet5.h"
 #include "models/lenet5_stolen.h"
@@ -31,17 +34,156 @@ extern "C" {
 #include "tensorflow/lite/micro/recording_micro_interpreter.h"
 #include "tensorflow/lite/micro/system_setup.h"
 #include "tensorflow/lite/schema/schema_generated.h"
+#include "xheep_kernels.h"
+
+// Release builds take the size measured by tflite_calibrate_arena() from a
+// generated header, see the app Makefile.
+#ifdef TFLITE_ARENA_HEADER
+#include TFLITE_ARENA_HEADER
+#endif
+#ifndef TFLITE_ARENA_SIZE
+#define TFLITE_ARENA_SIZE 0x4000
+#endif
+
+// Conv2D and FullyConnected run on xheep_nn.c; build with
+// -DTFLITE_XHEEP_KERNELS=0 to compare against the reference kernels.
+#ifndef TFLITE_XHEEP_KERNELS
+#define TFLITE_XHEEP_KERNELS 1
+#endif
 
 namespace {
-constexpr int kTensorArenaSize = 0x4000;
-uint8_t tensor_arena[kTensorArenaSize];
+constexpr int kTensorArenaSize = TFLITE_ARENA_SIZE;
+alignas(16) uint8_t tensor_arena[kTensorArenaSize];
 const tflite::Model* model = nullptr;
 
 using Lenet5OpResolver = tflite::MicroMutableOpResolver<7>;
 
+// The resolver and the interpreter live for the whole run: ops are registered
+// and the arena is planned once, each request only copies input and invokes.
+Lenet5OpResolver op_resolver;
+bool ops_registered = false;
+// Large enough for either interpreter; `recording` tells which one it holds.
+alignas(tflite::RecordingMicroInterpreter)
+    uint8_t interpreter_buffer[sizeof(tflite::RecordingMicroInterpreter)];
+tflite::MicroInterpreter* interpreter = nullptr;
+bool recording = false;
+// NN:PROFile:STATe, see tflite_set_profiling()
+bool cycle_profiling = false;
+TfLiteTensor* input = nullptr;
+TfLiteTensor* output = nullptr;
+
+// Stages request data into the input tensor; see tflite_set_input_copy().
+tflite_copy_fn_t input_copy = memcpy;
+
+// Attached with tflite_set_profiler(), independently of cycle_profiling.
+tflite::MicroProfilerInterface* external_profiler = nullptr;
+
+// Records the mcycle count of each operator of the current Invoke(). Events
+// do not nest, so the handle is simply the operator's index.
+constexpr uint32_t kMaxProfileOps = 32;
+
+class CycleProfiler : public tflite::MicroProfilerInterface {
+ public:
+  uint32_t BeginEvent(const char* tag) override {
+    if (num_ops_ == kMaxProfileOps) {
+      return kMaxProfileOps;
+    }
+    ops_[num_ops_].tag = tag;
+    ops_[num_ops_].cycles = 0;
+    start_[num_ops_] = Cycles();
+    return num_ops_++;
+  }
+
+  void EndEvent(uint32_t event_handle) override {
+    if (event_handle < num_ops_) {
+      ops_[event_handle].cycles = Cycles() - start_[event_handle];
+    }
+  }
+
+  void Clear() { num_ops_ = 0; }
+
+  size_t Get(const tflite_op_profile_t** ops) const {
+    *ops = ops_;
+    return num_ops_;
+  }
+
+ private:
+  static uint64_t Cycles() {
+    perf_counters_t now;
+    perf_counters_read(&now);
+    return now.cycles;
+  }
+
+  tflite_op_profile_t ops_[kMaxProfileOps];
+  uint64_t start_[kMaxProfileOps];
+  uint32_t num_ops_ = 0;
+};
+
+CycleProfiler cycle_profiler;
+
+// Reports each event to two profilers, for when the SCPI cycle profiler and
+// an external one are both attached.
+constexpr uint32_t kMaxFanoutEvents = 8;
+
+class ProfilerFanout : public tflite::MicroProfilerInterface {
+ public:
+  void Set(tflite::MicroProfilerInterface* first,
+           tflite::MicroProfilerInterface* second) {
+    profilers_[0] = first;
+    profilers_[1] = second;
+    num_open_ = 0;
+  }
+
+  uint32_t BeginEvent(const char* tag) override {
+    if (num_open_ == kMaxFanoutEvents) {
+      return kMaxFanoutEvents;
+    }
+    for (int i = 0; i < 2; ++i) {
+      handles_[num_open_][i] = profilers_[i]->BeginEvent(tag);
+    }
+    return num_open_++;
+  }
+
+  void EndEvent(uint32_t event_handle) override {
+    if (event_handle >= num_open_) {
+      return;
+    }
+    for (int i = 0; i < 2; ++i) {
+      profilers_[i]->EndEvent(handles_[event_handle][i]);
+    }
+    num_open_ = event_handle;
+  }
+
+ private:
+  tflite::MicroProfilerInterface* profilers_[2] = {nullptr, nullptr};
+  uint32_t handles_[kMaxFanoutEvents][2];
+  uint32_t num_open_ = 0;
+};
+
+ProfilerFanout profiler_fanout;
+
+// The profiler handed to the interpreter when it is planned
+tflite::MicroProfilerInterface* ActiveProfiler() {
+  if (!cycle_profiling) {
+    return external_profiler;
+  }
+  if (external_profiler == nullptr) {
+    return &cycle_profiler;
+  }
+  profiler_fanout.Set(&cycle_profiler, external_profiler);
+  return &profiler_fanout;
+}
+
 TfLiteStatus RegisterOps(Lenet5OpResolver& op_resolver) {
+#if TFLITE_XHEEP_KERNELS
+  TF_LITE_ENSURE_STATUS(
+      op_resolver.AddFullyConnected(tflite::Register_XHEEP_FULLY_CONNECTED()));
+  TF_LITE_ENSURE_STATUS(
+      op_resolver.AddConv2D(tflite::Register_XHEEP_CONV_2D()));
+#else
   TF_LITE_ENSURE_STATUS(op_resolver.AddFullyConnected());
   TF_LITE_ENSURE_STATUS(op_resolver.AddConv2D());
+#endif
   TF_LITE_ENSURE_STATUS(op_resolver.AddAveragePool2D());
   TF_LITE_ENSURE_STATUS(op_resolver.AddTanh());
   TF_LITE_ENSURE_STATUS(op_resolver.AddReshape());
@@ -49,42 +191,232 @@ TfLiteStatus RegisterOps(Lenet5OpResolver& op_resolver) {
   TF_LITE_ENSURE_STATUS(op_resolver.AddLogistic());
   return kTfLiteOk;
 }
+
+void ReleaseInterpreter() {
+  if (interpreter != nullptr) {
+    if (recording) {
+      static_cast<tflite::RecordingMicroInterpreter*>(interpreter)
+          ->~RecordingMicroInterpreter();
+    } else {
+      interpreter->~MicroInterpreter();
+    }
+    interpreter = nullptr;
+  }
+  input = nullptr;
+  output = nullptr;
+}
 }  // namespace
 
-TfLiteStatus LoadModel() {
-  if (model != nullptr) {
-    return kTfLiteOk;
+TfLiteStatus LoadModel(const uint8_t* model_data) {
+  const tflite::Model* candidate = ::tflite::GetModel(model_data);
+  if (candidate->version() != TFLITE_SCHEMA_VERSION) {
+    MicroPrintf("Model schema version %d not supported",
+                candidate->version());
+    return kTfLiteError;
   }
-  model = ::tflite::GetModel(tflite_rom);
-  TFLITE_CHECK_EQ(model->version(), TFLITE_SCHEMA_VERSION);
+  model = candidate;
   return kTfLiteOk;
 }
 
-TfLiteStatus Infer(const char *data, size_t len, int8_t **out, size_t *out_len) {
+TfLiteStatus PlanInterpreter() {
   if (model == nullptr) {
     return kTfLiteError;
   }
-  Lenet5OpResolver op_resolver;
-  TF_LITE_ENSURE_STATUS(RegisterOps(op_resolver));
-
-  tflite::MicroInterpreter interpreter(model, op_resolver, tensor_arena,
-                                       kTensorArenaSize);
-  TF_LITE_ENSURE_STATUS(interpreter.AllocateTensors());
-  TfLiteTensor* input = interpreter.input(0);
-  TFLITE_CHECK_NE(input, nullptr);
-  TfLiteTensor* output = interpreter.output(0);
-  TFLITE_CHECK_NE(output, nullptr);
-  memcpy(input->data.int8, data, len);
-  TF_LITE_ENSURE_STATUS(interpreter.Invoke());
+  if (!ops_registered) {
+    TF_LITE_ENSURE_STATUS(RegisterOps(op_resolver));
+    ops_registered = true;
+  }
+
+  ReleaseInterpreter();
+  tflite::MicroProfilerInterface* profiler = ActiveProfiler();
+  if (recording) {
+    interpreter = new (interpreter_buffer) tflite::RecordingMicroInterpreter(
+        model, op_resolver, tensor_arena, kTensorArenaSize, nullptr, profiler);
+  } else {
+    interpreter = new (interpreter_buffer)
+        tflite::MicroInterpreter(model, op_resolver, tensor_arena,
+                                 kTensorArenaSize, nullptr, profiler);
+  }
+  if (interpreter->AllocateTensors() != kTfLiteOk) {
+    ReleaseInterpreter();
+    return kTfLiteError;
+  }
+  input = interpreter->input(0);
+  output = interpreter->output(0);
+  if (input == nullptr || output == nullptr) {
+    ReleaseInterpreter();
+    return kTfLiteError;
+  }
+  return kTfLiteOk;
+}
+
+TfLiteStatus Infer(const char *data, size_t len, int8_t **out, size_t *out_len) {
+  if (interpreter == nullptr) {
+    return kTfLiteError;
+  }
+  if (len > input->bytes) {
+    return kTfLiteError;
+  }
+  if (data != reinterpret_cast<const char *>(input->data.int8)) {
+    input_copy(input->data.int8, data, len);
+  }
+  cycle_profiler.Clear();
+  TF_LITE_ENSURE_STATUS(interpreter->Invoke());
   *out = output->data.int8;
   *out_len = output->bytes;
 
   return kTfLiteOk;
 }
 
+extern "C" void tflite_set_input_copy(tflite_copy_fn_t copy) {
+  input_copy = copy != nullptr ? copy : memcpy;
+}
+
+extern "C" int8_t *tflite_input(size_t *len) {
+  if (interpreter == nullptr) {
+    *len = 0;
+    return nullptr;
+  }
+  *len = input->bytes;
+  return input->data.int8;
+}
+
+extern "C" size_t tflite_arena_used(size_t *size) {
+  if (size != nullptr) {
+    *size = kTensorArenaSize;
+  }
+  return interpreter != nullptr ? interpreter->arena_used_bytes() : 0;
+}
+
+int tflite_set_profiler(tflite::MicroProfilerInterface *new_profiler) {
+  external_profiler = new_profiler;
+  if (model == nullptr) {
+    return kTfLiteOk;
+  }
+  return PlanInterpreter();
+}
+
+extern "C" int tflite_set_profiling(int enable) {
+  recording = cycle_profiling = enable != 0;
+  cycle_profiler.Clear();
+  if (model == nullptr) {
+    return kTfLiteOk;
+  }
+  if (PlanInterpreter() == kTfLiteOk) {
+    return kTfLiteOk;
+  }
+  // The recording allocator needs some arena of its own; keep serving
+  // without it rather than leaving no interpreter at all
+  recording = cycle_profiling = false;
+  PlanInterpreter();
+  return kTfLiteError;
+}
+
+extern "C" int tflite_profiling(void) {
+  return cycle_profiling;
+}
+
+extern "C" size_t tflite_profile(const tflite_op_profile_t **ops) {
+  if (!cycle_profiling) {
+    *ops = nullptr;
+    return 0;
+  }
+  return cycle_profiler.Get(ops);
+}
+
+extern "C" size_t tflite_arena_records(tflite_arena_record_t *records,
+                                       size_t max) {
+  static const struct {
+    const char* name;
+    tflite::RecordedAllocationType type;
+  } kRecordTypes[] = {
+      {"EVAL_TENSOR", tflite::RecordedAllocationType::kTfLiteEvalTensorData},
+      {"PERSISTENT_TENSOR",
+       tflite::RecordedAllocationType::kPersistentTfLiteTensorData},
+      {"QUANTIZATION",
+       tflite::RecordedAllocationType::kPersistentTfLiteTensorQuantizationData},
+      {"PERSISTENT_BUFFER",
+       tflite::RecordedAllocationType::kPersistentBufferData},
+      {"VARIABLE_BUFFER",
+       tflite::RecordedAllocationType::kTfLiteTensorVariableBufferData},
+      {"NODE_REGISTRATION",
+       tflite::RecordedAllocationType::kNodeAndRegistrationArray},
+      {"OP_DATA", tflite::RecordedAllocationType::kOpData},
+  };
+  if (!recording || interpreter == nullptr) {
+    return 0;
+  }
+  const tflite::RecordingMicroAllocator& allocator =
+      static_cast<tflite::RecordingMicroInterpreter*>(interpreter)
+          ->GetMicroAllocator();
+  size_t n = 0;
+  for (const auto& record_type : kRecordTypes) {
+    if (n == max) {
+      break;
+    }
+    tflite::RecordedAllocation allocation =
+        allocator.GetRecordedAllocation(record_type.type);
+    records[n].name = record_type.name;
+    records[n].requested = allocation.requested_bytes;
+    records[n].used = allocation.used_bytes;
+    records[n].count = allocation.count;
+    ++n;
+  }
+  return n;
+}
+
+extern "C" int tflite_calibrate_arena(tflite_arena_usage_t *usage) {
+  if (model == nullptr) {
+    return kTfLiteError;
+  }
+  bool was_recording = recording;
+  recording = true;
+  TfLiteStatus status = PlanInterpreter();
+  if (status == kTfLiteOk) {
+    int8_t *out;
+    size_t out_len;
+    status = Infer(reinterpret_cast<const char *>(lenet_input_data),
+                   lenet_input_data_size, &out, &out_len);
+  }
+  if (status == kTfLiteOk) {
+    const tflite::RecordingSingleArenaBufferAllocator* arena =
+        static_cast<tflite::RecordingMicroInterpreter*>(interpreter)
+            ->GetMicroAllocator()
+            .GetSimpleMemoryAllocator();
+    // Rounded up to the arena alignment, so the result can be used as is
+    usage->required = (interpreter->arena_used_bytes() + 15) & ~size_t{15};
+    usage->persistent = arena->GetTailUsedBytes();
+    usage->nonpersistent = arena->GetHeadUsedBytes();
+    usage->size = kTensorArenaSize;
+  }
+  recording = was_recording;
+  if (PlanInterpreter() != kTfLiteOk) {
+    return kTfLiteError;
+  }
+  return status;
+}
+
 extern "C" int init_tflite() {
   tflite::InitializeTarget();
-  TF_LITE_ENSURE_STATUS(LoadModel());
+  TF_LITE_ENSURE_STATUS(LoadModel(tflite_rom));
+  TF_LITE_ENSURE_STATUS(PlanInterpreter());
+  return kTfLiteOk;
+}
+
+extern "C" int replan_tflite(const uint8_t *model_data) {
+  // A model with the wrong schema is refused before the current interpreter
+  // is touched; one that cannot be planned (e.g. does not fit the arena)
+  // gives way to the previous model again.
+  const tflite::Model* previous = model;
+  TF_LITE_ENSURE_STATUS(LoadModel(model_data));
+  if (PlanInterpreter() != kTfLiteOk) {
+    model = previous;
+    if (PlanInterpreter() != kTfLiteOk) {
+      MicroPrintf("Previous model could not be planned again");
+      return TFLITE_NO_INTERPRETER;
+    }
+    return kTfLiteError;
+  }
   return kTfLiteOk;
 }
 
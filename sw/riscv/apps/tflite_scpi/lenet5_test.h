@@ -8,11 +8,127 @@ extern "C" {
 #include <stdint.h>
 #include <stddef.h>
 
+/**
+ * Load the built-in model, register its ops and plan the tensor arena once.
+ */
 int init_tflite();
+
+/* replan_tflite() result when the previous model could not be planned again
+ * either: no interpreter is left, infer() fails until a model is planned. */
+#define TFLITE_NO_INTERPRETER (-1)
+
+/**
+ * Swap in another model: drops the current interpreter and re-plans the arena.
+ * On failure the previous model stays in service.
+ * @param model_data Flatbuffer of the new model, must outlive the interpreter.
+ * @return 0 on success, TFLITE_NO_INTERPRETER if not even the previous model
+ * could be planned again, another non-zero value otherwise.
+ */
+int replan_tflite(const uint8_t *model_data);
+
 int infer(const char *data, size_t len, int8_t **out, size_t *out_len);
 
+typedef void *(*tflite_copy_fn_t)(void *dest, const void *src, size_t len);
+
+/**
+ * Select the routine that stages input data into the input tensor.
+ * @param copy memcpy-compatible routine (e.g. dma_memcpy), NULL for memcpy.
+ */
+void tflite_set_input_copy(tflite_copy_fn_t copy);
+
+/**
+ * Input tensor of the planned interpreter, so requests can be received in
+ * place. Passing it back to infer() skips the staging copy.
+ * @param len Set to the tensor size in bytes.
+ * @return The tensor data, NULL if no interpreter is planned.
+ */
+int8_t *tflite_input(size_t *len);
+
+/**
+ * Arena high-water mark of the planned interpreter.
+ * @param size Set to the arena capacity in bytes, may be NULL.
+ * @return Bytes of the arena in use after planning, 0 if nothing is planned.
+ */
+size_t tflite_arena_used(size_t *size);
+
+/**
+ * Cycles spent in one operator by the last inference.
+ */
+typedef struct tflite_op_profile {
+  const char *tag;
+  uint64_t cycles;
+} tflite_op_profile_t;
+
+/**
+ * Arena allocations of one kind, as recorded by RecordingMicroAllocator.
+ */
+typedef struct tflite_arena_record {
+  const char *name;
+  size_t requested;
+  size_t used;
+  size_t count;
+} tflite_arena_record_t;
+
+/**
+ * Switch per-operator profiling on or off. The interpreter is re-planned, as
+ * a RecordingMicroInterpreter with an mcycle profiler when enabled; if that
+ * does not fit the arena, the plain interpreter is planned again. A profiler
+ * attached with tflite_set_profiler() stays attached either way.
+ * @return 0 on success.
+ */
+int tflite_set_profiling(int enable);
+
+/**
+ * @return Non-zero while per-operator profiling is enabled.
+ */
+int tflite_profiling(void);
+
+/**
+ * Per-operator cycles of the last inference, in execution order.
+ * @param ops Set to the profile, valid until the next inference.
+ * @return The number of operators, 0 if profiling is disabled.
+ */
+size_t tflite_profile(const tflite_op_profile_t **ops);
+
+/**
+ * Arena allocations by kind, while profiling is enabled.
+ * @param records Filled with up to `max` records.
+ * @return The number of records filled, 0 if profiling is disabled.
+ */
+size_t tflite_arena_records(tflite_arena_record_t *records, size_t max);
+
+/**
+ * Tensor arena needs measured by tflite_calibrate_arena().
+ */
+typedef struct tflite_arena_usage {
+  size_t required;       // Arena size to build with, in bytes
+  size_t persistent;     // Tail of the arena: tensors, op data, allocators
+  size_t nonpersistent;  // Head of the arena: activations and scratch
+  size_t size;           // Arena size of this build
+} tflite_arena_usage_t;
+
+/**
+ * Plan the model with a RecordingMicroInterpreter, run the built-in example
+ * once and report the arena it used, then plan the interpreter as before.
+ * The measurement includes the recording allocator's own bookkeeping, so it
+ * is an upper bound for the plain interpreter.
+ * @return 0 on success, non-zero if the model does not fit this build's arena.
+ */
+int tflite_calibrate_arena(tflite_arena_usage_t *usage);
+
 #ifdef __cplusplus
 }
+
+namespace tflite {
+class MicroProfilerInterface;
+}
+
+/**
+ * Attach a profiler to the interpreter, which is re-planned so that each op
+ * invocation is reported to it. NULL detaches it. The mcycle profiler of
+ * tflite_set_profiling() keeps receiving events alongside it.
+ */
+int tflite_set_profiler(tflite::MicroProfilerInterface *profiler);
 #endif
 
 #endif
@@ -711,6 +711,176 @@ scpi_bool_t composeCompoundCommand(const scpi_token_t * prev, scpi_token_t * cur
     return TRUE;
 }
 
+/*
+ * Command index keys
+ *
+ * A header and a pattern get the same key when every keyword starts with the
+ * same SCPI_KEY_PREFIX characters (case insensitive) and they agree on being
+ * a query. Both forms of a keyword share the first SCPI_KEY_PREFIX characters
+ * as long as the short form is that long, or the keyword has no long form,
+ * so one key covers every spelling the pattern accepts.
+ */
+#define SCPI_KEY_PREFIX 3
+#define SCPI_KEY_FNV_BASIS 2166136261u
+#define SCPI_KEY_FNV_PRIME 16777619u
+
+static uint32_t keyAdd(uint32_t key, char c) {
+    return (key ^ (uint8_t) toupper((unsigned char) c)) * SCPI_KEY_FNV_PRIME;
+}
+
+static uint32_t keyAddKeyword(uint32_t key, const char * word, size_t len) {
+    size_t i;
+    for (i = 0; i < len && i < SCPI_KEY_PREFIX; i++) {
+        key = keyAdd(key, word[i]);
+    }
+    return keyAdd(key, ':');
+}
+
+/**
+ * Compute the index key of a command pattern
+ * @param pattern eg. SYSTem:ERRor?
+ * @param key - computed key
+ * @return FALSE if the pattern uses optional keywords or numeric suffixes, or
+ * has a keyword that cannot be keyed, and must be matched by matchCommand
+ */
+scpi_bool_t commandPatternKey(const char * pattern, uint32_t * key) {
+    size_t len = strlen(pattern);
+    uint32_t k = SCPI_KEY_FNV_BASIS;
+    scpi_bool_t query = FALSE;
+
+    if (len == 0 || strnpbrk(pattern, len, "[]#") != NULL) {
+        return FALSE;
+    }
+    if (pattern[len - 1] == '?') {
+        query = TRUE;
+        len--;
+    }
+    if (len > 0 && pattern[0] == ':') {
+        pattern++;
+        len--;
+    }
+
+    while (1) {
+        size_t word_len = patternSeparatorPos(pattern, len);
+        size_t short_len = patternSeparatorShortPos(pattern, word_len);
+
+        if (short_len == 0 || (short_len < SCPI_KEY_PREFIX && short_len != word_len)) {
+            return FALSE;
+        }
+        k = keyAddKeyword(k, pattern, short_len);
+
+        if (word_len == len) {
+            break;
+        }
+        if (pattern[word_len] != ':') {
+            return FALSE;
+        }
+        pattern += word_len + 1;
+        len -= word_len + 1;
+    }
+
+    *key = query ? keyAdd(k, '?') : k;
+    return TRUE;
+}
+
+/**
+ * Compute the index key of a command header
+ * @param cmd - command header
+ * @param len - max search length
+ * @param key - computed key
+ * @return FALSE if no pattern with a key can match the header
+ */
+scpi_bool_t commandHeaderKey(const char * cmd, size_t len, uint32_t * key) {
+    uint32_t k = SCPI_KEY_FNV_BASIS;
+    scpi_bool_t query = FALSE;
+
+    len = SCPIDEFINE_strnlen(cmd, len);
+    if (len == 0) {
+        return FALSE;
+    }
+    if (cmd[len - 1] == '?') {
+        query = TRUE;
+        len--;
+    }
+    if (len > 0 && cmd[0] == ':') {
+        /* ":*IDN?" is not a valid header */
+        if (len < 2 || cmd[1] == '*') {
+            return FALSE;
+        }
+        cmd++;
+        len--;
+    }
+
+    while (1) {
+        size_t word_len = cmdSeparatorPos(cmd, len);
+
+        k = keyAddKeyword(k, cmd, word_len);
+        if (word_len == len) {
+            break;
+        }
+        cmd += word_len + 1;
+        len -= word_len + 1;
+    }
+
+    *key = query ? keyAdd(k, '?') : k;
+    return TRUE;
+}
+
+/**
+ * Compare a pattern accepted by commandPatternKey and a command header
+ * @param pattern eg. SYSTem:ERRor?
+ * @param cmd - command header
+ * @param len - max search length
+ * @return TRUE if pattern matches, FALSE otherwise
+ */
+scpi_bool_t matchPlainCommand(const char * pattern, const char * cmd, size_t len) {
+    size_t pattern_len = strlen(pattern);
+    size_t cmd_len = SCPIDEFINE_strnlen(cmd, len);
+
+    if (pattern_len == 0 || cmd_len == 0) {
+        return FALSE;
+    }
+    if ((pattern[pattern_len - 1] == '?') != (cmd[cmd_len - 1] == '?')) {
+        return FALSE;
+    }
+    if (pattern[pattern_len - 1] == '?') {
+        pattern_len--;
+        cmd_len--;
+    }
+    if (pattern_len > 0 && pattern[0] == ':') {
+        pattern++;
+        pattern_len--;
+    }
+    if (cmd_len > 0 && cmd[0] == ':') {
+        if (cmd_len < 2 || cmd[1] == '*') {
+            return FALSE;
+        }
+        cmd++;
+        cmd_len--;
+    }
+
+    while (1) {
+        size_t pattern_sep_pos = patternSeparatorPos(pattern, pattern_len);
+        size_t cmd_sep_pos = cmdSeparatorPos(cmd, cmd_len);
+
+        if (!compareStr(pattern, pattern_sep_pos, cmd, cmd_sep_pos) &&
+                !compareStr(pattern, patternSeparatorShortPos(pattern, pattern_sep_pos), cmd, cmd_sep_pos)) {
+            return FALSE;
+        }
+
+        if (pattern_sep_pos == pattern_len || cmd_sep_pos == cmd_len) {
+            return (pattern_sep_pos == pattern_len) && (cmd_sep_pos == cmd_len);
+        }
+        if (cmd[cmd_sep_pos] != ':') {
+            return FALSE;
+        }
+        pattern += pattern_sep_pos + 1;
+        pattern_len -= pattern_sep_pos + 1;
+        cmd += cmd_sep_pos + 1;
+        cmd_len -= cmd_sep_pos + 1;
+    }
+}
+
 
 
 #if !HAVE_STRNLEN
@@ -69,6 +69,9 @@ extern "C" {
     scpi_bool_t matchPattern(const char * pattern, size_t pattern_len, const char * str, size_t str_len, int32_t * num) LOCAL;
     scpi_bool_t matchCommand(const char * pattern, const char * cmd, size_t len, int32_t *numbers, size_t numbers_len, int32_t default_value) LOCAL;
     scpi_bool_t composeCompoundCommand(const scpi_token_t * prev, scpi_token_t * current) LOCAL;
+    scpi_bool_t commandPatternKey(const char * pattern, uint32_t * key) LOCAL;
+    scpi_bool_t commandHeaderKey(const char * cmd, size_t len, uint32_t * key) LOCAL;
+    scpi_bool_t matchPlainCommand(const char * pattern, const char * cmd, size_t len) LOCAL;
 
 #define SCPI_DTOSTRE_UPPERCASE   1
 #define SCPI_DTOSTRE_ALWAYS_SIGN 2
@@ -1,31 +1,32 @@
 #include <stdio.h>
-#include "models/lenet5_input.h"
 #include "lenet5_test.h"
 #include "scpi/scpi.h"
+#include "scpi_server.h"
 #include "uart.h"
+#include "dma_memcpy.h"
 #include "soc_ctrl.h"
 #include "core_v_mini_mcu.h"
 #include "mmio.h"
 #include "tee_syscall.h"
-
-#define ECHO 1
-
-#define SCPI_IDN1 "MANUFACTURE"
-#define SCPI_IDN2 "INSTR2013"
-#define SCPI_IDN3 NULL
-#define SCPI_IDN4 "01-02"
+#include "perf_region.h"
+#include "perf_stats.h"
 
 volatile soc_ctrl_t soc_ctrl;
-volatile scpi_t scpi_context;
 /* -------------------------------------------------------------- */
 //__attribute__((section(".user_data")))
-volatile uart_t uart;
+uart_t uart;
 
 __attribute__((section(".user_data")))
 volatile int exit_scpi = 0;
 
 __attribute__((section(".user_data")))
-char buffer[2048];
+char buffer[TEE_RING_SLOTS][TEE_RING_LINE];
+
+__attribute__((section(".user_data")))
+tee_ring_t request_ring;
+
+__attribute__((section(".user_data")))
+tee_counters_t infer_counters;
 
 /* linker symbols exported above */
 extern uint8_t __user_start, __user_end;
@@ -33,142 +34,32 @@ extern uint8_t __user_stack_top;
 extern uint8_t __user_text_start, __user_text_end;
 extern uint8_t __user_data_start; 
 /* -------------------------------------------------------------- */
-void __attribute__((noinline)) SCPI_from_user(const char *buf, size_t len) {
-  SCPI_Input(&scpi_context, buf, len);
-  SCPI_Input(&scpi_context, "\r\n", 2);
-  SCPI_Flush(&scpi_context);
-}
-/* -------------------------------------------------------------- */
-scpi_result_t __attribute__((noinline)) InferExample(scpi_t * context) { 
-  const char *out;
-  size_t len;
-  const int8_t *data = lenet_input_data;
-
-  int a = infer((const char *) data, lenet_input_data_size, &out, &len);
-
-  if (a == 0) {
-    SCPI_ResultArrayInt8(context, (const int8_t *) out, len, SCPI_FORMAT_ASCII);
-  } else {
-    SCPI_ResultText(context, "Error");
-  }
-  return SCPI_RES_OK;
-}
-
-scpi_result_t __attribute__((noinline)) InferData(scpi_t * context) {
-  const char *out;
-  size_t out_len;
-
-  const int8_t tflite_input_data[lenet_input_data_size];
-  const int8_t *scpi_out;
-  size_t scpi_len;
-  SCPI_ParamArbitraryBlock(context, &scpi_out, &scpi_len, true);
-  printf("Read: %d bytes\r\n", scpi_len);
-  memcpy(tflite_input_data, scpi_out, scpi_len);
-
-  int a = infer((const char *) tflite_input_data, lenet_input_data_size, &out, &out_len);
-  if (a == 0) {
-    SCPI_ResultArrayInt8(context, (const int8_t *) out, out_len, SCPI_FORMAT_ASCII);
-  } else {
-    SCPI_ResultText(context, "Inference error");
-  }
-  return SCPI_RES_OK;
-}
-
-scpi_result_t __attribute__((noinline))  Exit(scpi_t * context) {
-    exit_scpi = 1;
-    uart_write(&uart, (const uint8_t *) "Exiting...\r\n", 12);
-    return SCPI_RES_OK;
-}
-
-volatile scpi_command_t scpi_commands[] = {
-  { "NN:INFEr:EXAMple?", InferExample, 0},
-  { "NN:INFEr:DATA?", InferData, 0},
-  { "EXT", Exit, 0},
-	SCPI_CMD_LIST_END
-};
-
-size_t __attribute__((noinline)) scrivi(scpi_t * context, const char * data, size_t len) {
-    (void) context;
-    size_t a = uart_write(&uart, (const uint8_t *) data, len);
-    return a;
-}
-
-int __attribute__((noinline))  SCPI_Error(scpi_t * context, int_fast16_t err) {
-    (void) context;
-    uart_write(&uart, (const uint8_t *) "ERR!\r\n", 6);
-    return 0;
-}
-
-scpi_result_t __attribute__((noinline)) SCPI_Control(scpi_t * context, scpi_ctrl_name_t ctrl, scpi_reg_val_t val) {
-    return SCPI_RES_OK;
-}
-scpi_result_t __attribute__((noinline)) SCPI_Reset(scpi_t * context) {
-    return SCPI_RES_OK;
-}
-scpi_result_t __attribute__((noinline))  SCPI_Flush(scpi_t * context) {
-    return SCPI_RES_OK;
-}
-
-volatile scpi_interface_t scpi_interface = {
-	.write = scrivi,
-	.error = SCPI_Error,
-	.control = NULL,
-    .flush = NULL,
-    .reset = NULL
-};
-
-#define SCPI_INPUT_BUFFER_LENGTH 2048
-static char scpi_input_buffer[SCPI_INPUT_BUFFER_LENGTH];
-
-#define SCPI_ERROR_QUEUE_SIZE 17
-scpi_error_t scpi_error_queue_data[SCPI_ERROR_QUEUE_SIZE];
-
-__attribute__((section(".user_data")))
-static int modifier = 0;
 
 __attribute__((section(".user_text"), aligned(4), noinline))
 size_t __attribute__((noinline)) user_uart_loop(char *buf, size_t len) {
     
     while (!exit_scpi) {
-        size_t i = 0;
-        while (i < len - 1) {
-            uint8_t c;
-            c = tee_uart_getchar();
-            if (c == '\\') {
-                if (!modifier) modifier = 1;
-                else {
-                    buf[i] = c;
-                    i++;
-                    modifier = 0;
-                }
-                continue;
-            }
-            #if ECHO
-            tee_uart_putchar(c);
-            if (c == '\n') tee_uart_putchar('\r');
-            else if (c == '\r') tee_uart_putchar('\n');
-            #endif
-            if (c == '\n' || c == '\r') {
-                if (modifier) {
-                    buf[i] = c;
-                    i++;
-                    modifier = 0;
-                } else {
-                    buf[i] = '\0';
-                    break;
-                }
-            } else {
-                buf[i] = c;
-                i++;
-                modifier = 0;
-            }
-        }
+        /* one trap per line: echo and escape handling happen in M-mode */
+        uint32_t slot = request_ring.head % TEE_RING_SLOTS;
+        char *line = buf + slot * len;
+        size_t i = tee_uart_readline(line, len);
+        int more = (i & TEE_READLINE_MORE) != 0;
+        i &= ~TEE_READLINE_MORE;
 
         if (i > 0) {
-            tee_read_counters_arr();
-            tee_infer(buf, i);
-            tee_read_counters_arr();
-            tee_read_counters_arr();
+            request_ring.desc[slot].ptr = (uint32_t)(uintptr_t)line;
+            request_ring.desc[slot].len = i;
+            request_ring.desc[slot].status = TEE_RING_PENDING;
+            request_ring.head++;
+        }
+
+        /* queue lines while more are waiting, up to a full ring, then have
+         * M-mode parse them all in one trap */
+        uint32_t pending = request_ring.head - request_ring.tail;
+        if (pending > 0 && (!more || pending == TEE_RING_SLOTS)) {
+            tee_counters_start(kRegionDoorbell);
+            tee_ring_doorbell(&request_ring);
+            tee_counters_stop(&infer_counters, kRegionDoorbell);
         }
     }
     while (1);
@@ -176,12 +67,17 @@ size_t __attribute__((noinline)) user_uart_loop(char *buf, size_t len) {
 
 void switch_to_user_mode() {
     __asm__ volatile (
-        "la   a0,  buffer      \n"   /* buf  = &buffer[0]  */
-        "li   a1,  2048        \n"   /* len  = 2048        */
+        "la   a0,  buffer      \n"   /* buf  = &buffer[0][0]       */
+        "li   a1,  %0          \n"   /* len  = TEE_RING_LINE       */
         
         "la t0, user_uart_loop     \n"  // Load user function address
         "csrw mepc, t0             \n"  // Set MEPC 
 
+        /* syscalls run on the M-mode stack, from its top: main() and its
+         * callers are never returned to */
+        "la t0, _sp                \n"
+        "csrw mscratch, t0         \n"
+
         "la sp, __user_stack_top   \n" 
         "li t2, -16                \n"  
         "add sp, sp, t2            \n"  
@@ -195,7 +91,7 @@ void switch_to_user_mode() {
         "mret                      \n"  
         
         :
-        :
+        : "i" (TEE_RING_LINE)
         : "t0", "t1", "memory"
     );
 }
@@ -237,26 +133,21 @@ int main() {
     if (uart_init(&uart) != kErrorOk) {
         return;
     }
+    /* The UART rings are serviced by polling only: uart_async_init() is not
+     * called and the UART is not enabled in the PLIC. M-mode runs the server
+     * with interrupts off and drains the TX ring while it waits for input
+     * (scpi_server_readline()); an interrupt taken from user_uart_loop()
+     * would enter the C handler_irq_external() on the user stack, as only
+     * syscall_entry switches stacks. */
   printf("Initialized UART\r\n");
   printf("uart.base_addr: %p\r\n", uart.base_addr);
   printf("uart.baudrate: %d\r\n", uart.baudrate);
   printf("uart.clk_freq_hz: %d\r\n", uart.clk_freq_hz);
 
-    SCPI_Init(&scpi_context, 
-              scpi_commands, 
-              &scpi_interface, 
-              scpi_units_def, 
-              SCPI_IDN1, SCPI_IDN2, SCPI_IDN3, SCPI_IDN4, 
-              scpi_input_buffer, SCPI_INPUT_BUFFER_LENGTH,
-              scpi_error_queue_data, SCPI_ERROR_QUEUE_SIZE);
-
-  printf("Initialized x.ruSCPI\r\n");
-  // Print available SCPI commands
-  printf("Available SCPI commands:\r\n");
-  for (int i = 0; scpi_commands[i].pattern != NULL; i++) {
-    printf("%s\r\n", scpi_commands[i].pattern);
-  }
+    scpi_server_init();
+  dma_memcpy_init();
   init_tflite();
+  tflite_set_input_copy(dma_memcpy);
   printf("Initialized TFLite\r\n");
 
   pmp_setup();
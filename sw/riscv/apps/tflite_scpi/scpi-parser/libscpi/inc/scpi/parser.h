@@ -56,6 +56,10 @@ extern "C" {
 #endif
 
     scpi_bool_t SCPI_Input(scpi_t * context, const char * data, int len);
+#if USE_BLOCK_SINK
+    void SCPI_SetBlockSink(scpi_t * context, const char * pattern, scpi_block_sink_t sink);
+    scpi_bool_t SCPI_InputBlockPending(scpi_t * context);
+#endif
     scpi_bool_t SCPI_Parse(scpi_t * context, char * data, int len);
 
     size_t SCPI_ResultCharacters(scpi_t * context, const char * data, size_t len);
@@ -413,6 +413,36 @@ extern "C" {
 #endif /* USE_COMMAND_TAGS */
     };
 
+#if USE_COMMAND_INDEX
+    /* Command lookup built by SCPI_Init. Chains hold command list indexes in
+     * ascending order, terminated by -1. */
+    struct _scpi_command_index_t {
+        int16_t bucket[SCPI_COMMAND_INDEX_BUCKETS];
+        int16_t next[SCPI_COMMAND_INDEX_MAX];
+        int16_t fallback;
+        int16_t count;
+    };
+    typedef struct _scpi_command_index_t scpi_command_index_t;
+#endif /* USE_COMMAND_INDEX */
+
+#if USE_BLOCK_SINK
+    /* Returns where to store a streamed block of len bytes, or NULL to let
+     * the block go through the input buffer */
+    typedef char * (*scpi_block_sink_t)(scpi_t * context, size_t len);
+
+    struct _scpi_block_stream_t {
+        const char * pattern;
+        scpi_block_sink_t sink;
+        char * data;
+        size_t len;
+        size_t remaining;
+        scpi_bool_t header;
+        scpi_bool_t active;
+        scpi_bool_t ready;
+    };
+    typedef struct _scpi_block_stream_t scpi_block_stream_t;
+#endif /* USE_BLOCK_SINK */
+
     struct _scpi_interface_t {
         scpi_error_callback_t error;
         scpi_write_t write;
@@ -440,6 +470,12 @@ extern "C" {
         scpi_parser_state_t parser_state;
         const char * idn[4];
         size_t arbitrary_remaining;
+#if USE_COMMAND_INDEX
+        scpi_command_index_t cmd_index;
+#endif
+#if USE_BLOCK_SINK
+        scpi_block_stream_t block_stream;
+#endif
     };
 
     enum _scpi_array_format_t {
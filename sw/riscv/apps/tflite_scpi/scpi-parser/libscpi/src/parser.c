@@ -157,6 +157,13 @@ static scpi_bool_t processCommand(scpi_t * context) {
         }
     }
 
+#if USE_BLOCK_SINK
+    /* a streamed block belongs to the sink command only */
+    if (context->block_stream.ready && strcmp(cmd->pattern, context->block_stream.pattern) == 0) {
+        context->block_stream.ready = FALSE;
+    }
+#endif
+
     /* set error if command callback did not read all parameters */
     if (state->pos < (state->buffer + state->len) && !context->cmd_error) {
         SCPI_ErrorPush(context, SCPI_ERROR_PARAMETER_NOT_ALLOWED);
@@ -166,8 +173,41 @@ static scpi_bool_t processCommand(scpi_t * context) {
     return result;
 }
 
+#if USE_COMMAND_INDEX
+/**
+ * Build the command lookup. Plain patterns are hashed by their keywords,
+ * patterns with optional keywords or numeric suffixes are chained for
+ * matchCommand.
+ * @param context
+ */
+static void buildCommandIndex(scpi_t * context) {
+    scpi_command_index_t * index = &context->cmd_index;
+    int16_t i;
+    uint32_t key;
+
+    for (i = 0; i < SCPI_COMMAND_INDEX_BUCKETS; i++) {
+        index->bucket[i] = -1;
+    }
+    index->fallback = -1;
+
+    for (i = 0; i < SCPI_COMMAND_INDEX_MAX && context->cmdlist[i].pattern != NULL; i++) {
+    }
+    index->count = i;
+
+    /* push in reverse so every chain ends up in command list order */
+    while (i-- > 0) {
+        int16_t * head = &index->fallback;
+        if (commandPatternKey(context->cmdlist[i].pattern, &key)) {
+            head = &index->bucket[key & (SCPI_COMMAND_INDEX_BUCKETS - 1)];
+        }
+        index->next[i] = *head;
+        *head = i;
+    }
+}
+#endif /* USE_COMMAND_INDEX */
+
 /**
- * Cycle all patterns and search matching pattern. Execute command callback.
+ * Search the first pattern matching the header.
  * @param context
  * @result TRUE if context->paramlist is filled with correct values
  */
@@ -175,7 +215,39 @@ static scpi_bool_t findCommandHeader(scpi_t * context, const char * header, int
     int32_t i;
     const scpi_command_t * cmd;
 
-    for (i = 0; context->cmdlist[i].pattern != NULL; i++) {
+#if USE_COMMAND_INDEX
+    const scpi_command_index_t * index = &context->cmd_index;
+    int32_t found = -1;
+    uint32_t key;
+
+    if (commandHeaderKey(header, len, &key)) {
+        for (i = index->bucket[key & (SCPI_COMMAND_INDEX_BUCKETS - 1)]; i >= 0; i = index->next[i]) {
+            if (matchPlainCommand(context->cmdlist[i].pattern, header, len)) {
+                found = i;
+                break;
+            }
+        }
+    }
+
+    /* an earlier pattern that needs the full matcher still takes precedence */
+    for (i = index->fallback; i >= 0 && (found < 0 || i < found); i = index->next[i]) {
+        if (matchCommand(context->cmdlist[i].pattern, header, len, NULL, 0, 0)) {
+            found = i;
+            break;
+        }
+    }
+
+    if (found >= 0) {
+        context->param_list.cmd = &context->cmdlist[found];
+        return TRUE;
+    }
+
+    i = index->count;
+#else
+    i = 0;
+#endif /* USE_COMMAND_INDEX */
+
+    for (; context->cmdlist[i].pattern != NULL; i++) {
         cmd = &context->cmdlist[i];
         if (matchCommand(cmd->pattern, header, len, NULL, 0, 0)) {
             context->param_list.cmd = cmd;
@@ -286,6 +358,9 @@ void SCPI_Init(scpi_t * context,
     context->buffer.length = input_buffer_length;
     context->buffer.position = 0;
     SCPI_ErrorInit(context, error_queue_data, error_queue_size);
+#if USE_COMMAND_INDEX
+    buildCommandIndex(context);
+#endif
 }
 
 #if USE_DEVICE_DEPENDENT_ERROR_INFORMATION && !USE_MEMORY_ALLOCATION_FREE
@@ -303,6 +378,222 @@ void SCPI_InitHeap(scpi_t * context,
 }
 #endif
 
+/**
+ * Add data to the input buffer and parse every complete program message
+ * @param context
+ * @param data - data to process
+ * @param len - length of data, must be > 0
+ * @return
+ */
+static scpi_bool_t bufferInput(scpi_t * context, const char * data, int len) {
+    scpi_bool_t result = TRUE;
+    size_t totcmdlen = 0;
+    int cmdlen = 0;
+    int buffer_free;
+
+    buffer_free = context->buffer.length - context->buffer.position;
+    if (len > (buffer_free - 1)) {
+        /* Input buffer overrun - invalidate buffer */
+        context->buffer.position = 0;
+        context->buffer.data[context->buffer.position] = 0;
+        SCPI_ErrorPush(context, SCPI_ERROR_INPUT_BUFFER_OVERRUN);
+        return FALSE;
+    }
+    memcpy(&context->buffer.data[context->buffer.position], data, len);
+    context->buffer.position += len;
+    context->buffer.data[context->buffer.position] = 0;
+
+
+    while (1) {
+        cmdlen = scpiParser_detectProgramMessageUnit(&context->parser_state, context->buffer.data + totcmdlen, context->buffer.position - totcmdlen);
+        totcmdlen += cmdlen;
+
+        if (context->parser_state.termination == SCPI_MESSAGE_TERMINATION_NL) {
+            result = SCPI_Parse(context, context->buffer.data, totcmdlen);
+            memmove(context->buffer.data, context->buffer.data + totcmdlen, context->buffer.position - totcmdlen);
+            context->buffer.position -= totcmdlen;
+            totcmdlen = 0;
+        } else {
+            if (context->parser_state.programHeader.type == SCPI_TOKEN_UNKNOWN
+                    && context->parser_state.termination == SCPI_MESSAGE_TERMINATION_NONE) break;
+            if (totcmdlen >= context->buffer.position) break;
+        }
+    }
+
+    return result;
+}
+
+#if USE_BLOCK_SINK
+/**
+ * Check whether the input buffer ends with the header of a definite length
+ * arbitrary block passed as the first parameter of the sink command,
+ * eg. "NN:INFE:DATA? #42048"
+ * @param context
+ * @param block_pos - position of '#' in the input buffer
+ * @param block_len - payload length
+ * @return -1 if the buffer tail cannot be such a header, 0 if it may become
+ * one with more data, 1 if it is complete
+ */
+static int detectBlockHeader(scpi_t * context, size_t * block_pos, size_t * block_len) {
+    const char * buffer = context->buffer.data;
+    size_t position = context->buffer.position;
+    size_t hash, unit, digits, i;
+    lex_state_t lex_state;
+    scpi_token_t header, tmp;
+
+    for (hash = position; hash > 0 && buffer[hash - 1] != '#'; hash--) {
+    }
+    if (hash == 0) {
+        return -1;
+    }
+    hash--;
+
+    for (unit = hash; unit > 0; unit--) {
+        char c = buffer[unit - 1];
+        if (c == ';' || c == '\r' || c == '\n') {
+            break;
+        }
+    }
+
+    lex_state.buffer = lex_state.pos = (char *) buffer + unit;
+    lex_state.len = hash - unit;
+    scpiLex_WhiteSpace(&lex_state, &tmp);
+    if (scpiLex_ProgramHeader(&lex_state, &header) <= 0
+            || scpiLex_WhiteSpace(&lex_state, &tmp) <= 0
+            || lex_state.pos != buffer + hash
+            || !matchCommand(context->block_stream.pattern, header.ptr, header.len, NULL, 0, 0)) {
+        return -1;
+    }
+
+    /* #<digits><length> */
+    if (position < hash + 2) {
+        return 0;
+    }
+    if (buffer[hash + 1] < '1' || buffer[hash + 1] > '9') {
+        return -1;
+    }
+    digits = buffer[hash + 1] - '0';
+
+    *block_len = 0;
+    for (i = hash + 2; i < position; i++) {
+        if (!isdigit((unsigned char) buffer[i])) {
+            return -1;
+        }
+        *block_len = *block_len * 10 + (buffer[i] - '0');
+    }
+    if (position - (hash + 2) < digits) {
+        return 0;
+    }
+
+    *block_pos = hash;
+    return 1;
+}
+
+/**
+ * Feed input while a block sink is registered: everything goes through the
+ * input buffer except the payload of the sink command's block, which is
+ * copied straight to the sink. The parser then sees an empty block
+ * that SCPI_ParamArbitraryBlock replaces with the sink data.
+ * @param context
+ * @param data - data to process
+ * @param len - length of data
+ * @return
+ */
+static scpi_bool_t streamInput(scpi_t * context, const char * data, int len) {
+    scpi_block_stream_t * stream = &context->block_stream;
+    scpi_bool_t result = TRUE;
+
+    while (len > 0) {
+        const char * hash;
+        int head, state;
+        size_t block_pos, block_len;
+
+        if (stream->active) {
+            size_t chunk = min(stream->remaining, (size_t) len);
+            memcpy(stream->data + (stream->len - stream->remaining), data, chunk);
+            stream->remaining -= chunk;
+            data += chunk;
+            len -= chunk;
+            if (stream->remaining == 0) {
+                stream->active = FALSE;
+                stream->ready = TRUE;
+                result &= bufferInput(context, "#10", 3);
+            }
+            continue;
+        }
+
+        /* a block header may be split across calls */
+        state = stream->header ? 0 : -1;
+        if (state != 0) {
+            hash = memchr(data, '#', len);
+            if (hash == NULL) {
+                result &= bufferInput(context, data, len);
+                break;
+            }
+
+            /* up to and including '#', then the block header byte by byte */
+            head = hash - data + 1;
+            result &= bufferInput(context, data, head);
+            data += head;
+            len -= head;
+            state = detectBlockHeader(context, &block_pos, &block_len);
+        }
+
+        while (state == 0 && len > 0) {
+            result &= bufferInput(context, data, 1);
+            data++;
+            len--;
+            state = detectBlockHeader(context, &block_pos, &block_len);
+        }
+        stream->header = (state == 0);
+
+        if (state == 1) {
+            char * sink_data = stream->sink(context, block_len);
+            if (sink_data != NULL) {
+                context->buffer.position = block_pos;
+                context->buffer.data[block_pos] = 0;
+                stream->data = sink_data;
+                stream->len = block_len;
+                stream->remaining = block_len;
+                stream->active = TRUE;
+                stream->ready = FALSE;
+                if (block_len == 0) {
+                    stream->active = FALSE;
+                    stream->ready = TRUE;
+                    result &= bufferInput(context, "#10", 3);
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+/**
+ * Register the command whose arbitrary block parameter is streamed to sink.
+ * The block must be the first parameter, the header must not rely on a
+ * previous compound header and only one block is streamed per program
+ * message. Pass NULL sink to disable streaming.
+ * @param context
+ * @param pattern - command pattern, eg. "NN:INFEr:DATA?"
+ * @param sink - provides the destination of each block
+ */
+void SCPI_SetBlockSink(scpi_t * context, const char * pattern, scpi_block_sink_t sink) {
+    memset(&context->block_stream, 0, sizeof (context->block_stream));
+    context->block_stream.pattern = pattern;
+    context->block_stream.sink = sink;
+}
+
+/**
+ * @param context
+ * @return TRUE while the payload of a streamed block is still expected, so
+ * the application must not inject line terminators
+ */
+scpi_bool_t SCPI_InputBlockPending(scpi_t * context) {
+    return context->block_stream.active;
+}
+#endif /* USE_BLOCK_SINK */
+
 /**
  * Interface to the application. Adds data to system buffer and try to search
  * command line termination. If the termination is found or if len=0, command
@@ -315,44 +606,17 @@ void SCPI_InitHeap(scpi_t * context,
  */
 scpi_bool_t SCPI_Input(scpi_t * context, const char * data, int len) {
     scpi_bool_t result = TRUE;
-    size_t totcmdlen = 0;
-    int cmdlen = 0;
 
     if (len == 0) {
         context->buffer.data[context->buffer.position] = 0;
         result = SCPI_Parse(context, context->buffer.data, context->buffer.position);
         context->buffer.position = 0;
+#if USE_BLOCK_SINK
+    } else if (context->block_stream.sink != NULL) {
+        result = streamInput(context, data, len);
+#endif
     } else {
-        int buffer_free;
-
-        buffer_free = context->buffer.length - context->buffer.position;
-        if (len > (buffer_free - 1)) {
-            /* Input buffer overrun - invalidate buffer */
-            context->buffer.position = 0;
-            context->buffer.data[context->buffer.position] = 0;
-            SCPI_ErrorPush(context, SCPI_ERROR_INPUT_BUFFER_OVERRUN);
-            return FALSE;
-        }
-        memcpy(&context->buffer.data[context->buffer.position], data, len);
-        context->buffer.position += len;
-        context->buffer.data[context->buffer.position] = 0;
-
-
-        while (1) {
-            cmdlen = scpiParser_detectProgramMessageUnit(&context->parser_state, context->buffer.data + totcmdlen, context->buffer.position - totcmdlen);
-            totcmdlen += cmdlen;
-
-            if (context->parser_state.termination == SCPI_MESSAGE_TERMINATION_NL) {
-                result = SCPI_Parse(context, context->buffer.data, totcmdlen);
-                memmove(context->buffer.data, context->buffer.data + totcmdlen, context->buffer.position - totcmdlen);
-                context->buffer.position -= totcmdlen;
-                totcmdlen = 0;
-            } else {
-                if (context->parser_state.programHeader.type == SCPI_TOKEN_UNKNOWN
-                        && context->parser_state.termination == SCPI_MESSAGE_TERMINATION_NONE) break;
-                if (totcmdlen >= context->buffer.position) break;
-            }
-        }
+        result = bufferInput(context, data, len);
     }
 
     return result;
@@ -1175,6 +1439,14 @@ scpi_bool_t SCPI_ParamArbitraryBlock(scpi_t * context, const char ** value, size
         if (param.type == SCPI_TOKEN_ARBITRARY_BLOCK_PROGRAM_DATA) {
             *value = param.ptr;
             *len = param.len;
+#if USE_BLOCK_SINK
+            /* the payload went to the sink, the parser only saw "#10" */
+            if (context->block_stream.ready && param.len == 0) {
+                *value = context->block_stream.data;
+                *len = context->block_stream.len;
+                context->block_stream.ready = FALSE;
+            }
+#endif
         } else {
             SCPI_ErrorPush(context, SCPI_ERROR_DATA_TYPE_ERROR);
             result = FALSE;
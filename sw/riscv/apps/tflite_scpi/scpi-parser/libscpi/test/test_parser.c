@@ -69,11 +69,13 @@ static scpi_result_t test_treeB(scpi_t* context) {
 }
 
 static double test_sample_received = NAN;
+static const char * test_sample_data = NULL;
 
 static scpi_result_t SCPI_Sample(scpi_t * context) {
     const char * val;
     size_t len;
     if (!SCPI_ParamArbitraryBlock(context, &val, &len, TRUE)) return SCPI_RES_ERR;
+    test_sample_data = val;
     if (len != sizeof(test_sample_received)) return SCPI_RES_ERR;
     memcpy(&test_sample_received, val, sizeof(test_sample_received));
     return SCPI_RES_OK;
@@ -292,6 +294,20 @@ static void testCommandsHandling(void) {
     TEST_INPUT("TEXT? \"\", \"test\r\n\"\r\n", "\"test\r\n\"\r\n");
     output_buffer_clear();
 
+    /* Test command lookup: short and long forms, case, leading colon */
+    TEST_INPUT("test:treea?\r\n", "10\r\n");
+    output_buffer_clear();
+
+    TEST_INPUT(":TEST:TREEB?\r\n", "20\r\n");
+    output_buffer_clear();
+
+    TEST_INPUT("SYST:VERS?;:SYSTEM:VERSION?\r\n", "1999.0;1999.0\r\n");
+    output_buffer_clear();
+
+    /* Test command lookup with optional keywords */
+    TEST_INPUT("SYST:ERR?;:SYST:ERR:NEXT?\r\n", "0,\"No error\";0,\"No error\"\r\n");
+    output_buffer_clear();
+
     CU_ASSERT_EQUAL(err_buffer_pos, 0);
     error_buffer_clear();
 }
@@ -1668,6 +1684,53 @@ static void testIncompleteArbitraryParameter(void) {
     TEST_INCOMPLETE_ARB(0.500000024214387, 1);
 }
 
+static double test_sample_sink_buffer;
+
+static char * test_sample_sink(scpi_t * context, size_t len) {
+    (void) context;
+    return len <= sizeof(test_sample_sink_buffer) ? (char *) &test_sample_sink_buffer : NULL;
+}
+
+static void testStreamedArbitraryParameter(void) {
+    SCPI_SetBlockSink(&scpi_context, "SAMple", test_sample_sink);
+
+    TEST_INCOMPLETE_ARB(0.5, 19);
+    CU_ASSERT_PTR_EQUAL(test_sample_data, (const char *) &test_sample_sink_buffer);
+    TEST_INCOMPLETE_ARB(0.5, 11);
+    CU_ASSERT_PTR_EQUAL(test_sample_data, (const char *) &test_sample_sink_buffer);
+    TEST_INCOMPLETE_ARB(0.501220703125, 9);
+    TEST_INCOMPLETE_ARB(0.501220703125, 7);
+    TEST_INCOMPLETE_ARB(0.500000024214387, 3);
+    TEST_INCOMPLETE_ARB(0.500000024214387, 1);
+    CU_ASSERT_PTR_EQUAL(test_sample_data, (const char *) &test_sample_sink_buffer);
+    CU_ASSERT_FALSE(SCPI_InputBlockPending(&scpi_context));
+
+    /* blocks the sink refuses are buffered as usual */
+    output_buffer_clear();
+    SCPI_ErrorClear(&scpi_context);
+    SCPI_Input(&scpi_context, "SAM #210", 8);
+    CU_ASSERT_FALSE(SCPI_InputBlockPending(&scpi_context));
+    SCPI_Input(&scpi_context, "0123456789\r\n", 12);
+    CU_ASSERT_PTR_NOT_EQUAL(test_sample_data, (const char *) &test_sample_sink_buffer);
+    CU_ASSERT_EQUAL(SCPI_ErrorCount(&scpi_context), 1);
+    SCPI_ErrorClear(&scpi_context);
+
+    /* other commands in the same message are not affected */
+    test_sample_received = NAN;
+    SCPI_Input(&scpi_context, "*IDN?;SAM #18", 13);
+    CU_ASSERT_TRUE(SCPI_InputBlockPending(&scpi_context));
+    SCPI_Input(&scpi_context, "\0\0\0\0\0\0\xe0?", 8);
+    CU_ASSERT_FALSE(SCPI_InputBlockPending(&scpi_context));
+    SCPI_Input(&scpi_context, ";*IDN?\r\n", 8);
+    CU_ASSERT_STRING_EQUAL("MA,IN,0,VER;MA,IN,0,VER\r\n", output_buffer);
+    CU_ASSERT_EQUAL(test_sample_received, 0.5);
+    CU_ASSERT_PTR_EQUAL(test_sample_data, (const char *) &test_sample_sink_buffer);
+
+    SCPI_SetBlockSink(&scpi_context, NULL, NULL);
+    TEST_INCOMPLETE_ARB(0.5, 5);
+    CU_ASSERT_PTR_NOT_EQUAL(test_sample_data, (const char *) &test_sample_sink_buffer);
+}
+
 #define TEST_INCOMPLETE_TEXT(_text, _part_len) do {\
     char command_text[] = "TEXT? \"\", \"" _text "\"\r";\
     char * command = command_text;\
@@ -1762,6 +1825,7 @@ int main() {
             || (NULL == CU_add_test(pSuite, "SCPI_ErrorQueue", testErrorQueue))
             || (NULL == CU_add_test(pSuite, "Incomplete arbitrary parameter", testIncompleteArbitraryParameter))
             || (NULL == CU_add_test(pSuite, "Incomplete text parameter", testIncompleteTextParameter))
+            || (NULL == CU_add_test(pSuite, "Streamed arbitrary parameter", testStreamedArbitraryParameter))
             ) {
         CU_cleanup_registry();
         return CU_get_error();
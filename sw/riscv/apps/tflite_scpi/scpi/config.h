@@ -114,6 +114,30 @@ extern "C" {
 #define USE_COMMAND_TAGS 1
 #endif
 
+/* Build a hashed command lookup at SCPI_Init instead of walking the whole
+ * command list with matchCommand for every header */
+#ifndef USE_COMMAND_INDEX
+#define USE_COMMAND_INDEX 1
+#endif
+
+#if USE_COMMAND_INDEX
+/* Number of hash buckets, must be a power of two */
+#ifndef SCPI_COMMAND_INDEX_BUCKETS
+#define SCPI_COMMAND_INDEX_BUCKETS 32
+#endif
+
+/* Commands past this position in the list are searched linearly */
+#ifndef SCPI_COMMAND_INDEX_MAX
+#define SCPI_COMMAND_INDEX_MAX 64
+#endif
+#endif
+
+/* Let one command receive a definite length arbitrary block directly into
+ * caller memory instead of the input buffer */
+#ifndef USE_BLOCK_SINK
+#define USE_BLOCK_SINK 1
+#endif
+
 #ifndef USE_DEPRECATED_FUNCTIONS
 #define USE_DEPRECATED_FUNCTIONS 1
 #endif
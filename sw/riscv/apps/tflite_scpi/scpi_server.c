@@ -0,0 +1,407 @@
+// Copyright EPFL contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+/* SCPI command handlers of the inference server. They run in M-mode on the
+ * board and natively in the host build (sw/riscv/host). */
+
+#include <stdio.h>
+#include "models/lenet5_input.h"
+#include "lenet5_test.h"
+#include "scpi/scpi.h"
+#include "uart.h"
+#include "perf_region.h"
+#include "perf_stats.h"
+#include "scpi_server.h"
+
+#define SCPI_IDN1 "MANUFACTURE"
+#define SCPI_IDN2 "INSTR2013"
+#define SCPI_IDN3 NULL
+#define SCPI_IDN4 "01-02"
+
+scpi_t scpi_context;
+
+/* FORMat:DATA choices; INT8 sends scores as a definite-length block */
+const scpi_choice_def_t result_formats[] = {
+  { "ASCii", SCPI_FORMAT_ASCII },
+  { "INT8", SCPI_FORMAT_NORMAL },
+  SCPI_CHOICE_LIST_END
+};
+
+scpi_array_format_t result_format = SCPI_FORMAT_ASCII;
+
+scpi_result_t __attribute__((noinline)) FormatData(scpi_t * context) {
+  int32_t format;
+  if (!SCPI_ParamChoice(context, result_formats, &format, true)) {
+    return SCPI_RES_ERR;
+  }
+  result_format = (scpi_array_format_t) format;
+  return SCPI_RES_OK;
+}
+
+scpi_result_t __attribute__((noinline)) FormatDataQ(scpi_t * context) {
+  const char *name;
+  SCPI_ChoiceToName(result_formats, result_format, &name);
+  SCPI_ResultMnemonic(context, name);
+  return SCPI_RES_OK;
+}
+
+scpi_result_t __attribute__((noinline)) InferExample(scpi_t * context) { 
+  int8_t *out;
+  size_t len;
+  const int8_t *data = lenet_input_data;
+
+  perf_region_begin(kRegionInvoke);
+  int a = infer((const char *) data, lenet_input_data_size, &out, &len);
+  perf_region_end(kRegionInvoke);
+
+  if (a == 0) {
+    perf_region_begin(kRegionFormat);
+    SCPI_ResultArrayInt8(context, out, len, result_format);
+    perf_region_end(kRegionFormat);
+  } else {
+    SCPI_ResultText(context, "Error");
+  }
+  return SCPI_RES_OK;
+}
+
+/* Receives NN:INFEr:DATA? blocks straight into the input tensor */
+char * InferDataSink(scpi_t * context, size_t len) {
+  (void) context;
+  size_t tensor_len;
+  int8_t *tensor = tflite_input(&tensor_len);
+  if (tensor == NULL || len > tensor_len) {
+    return NULL;
+  }
+  return (char *) tensor;
+}
+
+scpi_result_t __attribute__((noinline)) InferData(scpi_t * context) {
+  int8_t *out;
+  size_t out_len;
+
+  const char *scpi_out;
+  size_t scpi_len;
+  if (!SCPI_ParamArbitraryBlock(context, &scpi_out, &scpi_len, true)) {
+    return SCPI_RES_ERR;
+  }
+  if (scpi_len > lenet_input_data_size) {
+    SCPI_ErrorPush(context, SCPI_ERROR_DATA_OUT_OF_RANGE);
+    return SCPI_RES_ERR;
+  }
+
+  perf_region_begin(kRegionInvoke);
+  int a = infer(scpi_out, scpi_len, &out, &out_len);
+  perf_region_end(kRegionInvoke);
+  if (a == 0) {
+    perf_region_begin(kRegionFormat);
+    SCPI_ResultArrayInt8(context, out, out_len, result_format);
+    perf_region_end(kRegionFormat);
+  } else {
+    SCPI_ResultText(context, "Inference error");
+  }
+  return SCPI_RES_OK;
+}
+
+/* Bytes of the input tensor, the largest NN:INFEr:DATA? block */
+scpi_result_t __attribute__((noinline)) InputSizeQ(scpi_t * context) {
+  size_t len;
+  if (tflite_input(&len) == NULL) {
+    SCPI_ErrorPush(context, SCPI_ERROR_EXECUTION_ERROR);
+    return SCPI_RES_ERR;
+  }
+  SCPI_ResultUInt32(context, (uint32_t) len);
+  return SCPI_RES_OK;
+}
+
+/* One row per region with measurements: id, count, min, max and mean cycles,
+ * mean instructions, then the PERF_STATS_HIST_BINS histogram bins. With a
+ * region id as parameter only that region is reported, even if empty. Without
+ * one and no region measured yet the reply is a single 0, never an empty line
+ * (which clients skip while waiting for a reply). */
+static void PerfStatsRow(scpi_t * context, uint32_t region, const perf_stats_t *stats) {
+  SCPI_ResultUInt32(context, region);
+  SCPI_ResultUInt32(context, stats->count);
+  SCPI_ResultUInt64(context, stats->min_cycles);
+  SCPI_ResultUInt64(context, stats->max_cycles);
+  SCPI_ResultUInt64(context, stats->count ? stats->sum_cycles / stats->count : 0);
+  SCPI_ResultUInt64(context, stats->count ? stats->sum_instret / stats->count : 0);
+  for (uint32_t i = 0; i < PERF_STATS_HIST_BINS; ++i) {
+    SCPI_ResultUInt32(context, stats->hist[i]);
+  }
+}
+
+scpi_result_t __attribute__((noinline)) PerfStatsQ(scpi_t * context) {
+  uint32_t region;
+  if (SCPI_ParamUInt32(context, &region, false)) {
+    const perf_stats_t *stats = perf_stats_get(region);
+    if (stats == NULL) {
+      SCPI_ErrorPush(context, SCPI_ERROR_ILLEGAL_PARAMETER_VALUE);
+      return SCPI_RES_ERR;
+    }
+    PerfStatsRow(context, region, stats);
+    return SCPI_RES_OK;
+  }
+  if (SCPI_ParamErrorOccurred(context)) {
+    return SCPI_RES_ERR;
+  }
+  scpi_bool_t any = FALSE;
+  for (uint32_t i = 0; i < PERF_STATS_REGIONS; ++i) {
+    const perf_stats_t *stats = perf_stats_get(i);
+    if (stats->count > 0) {
+      PerfStatsRow(context, i, stats);
+      any = TRUE;
+    }
+  }
+  if (!any) {
+    SCPI_ResultUInt32(context, 0);
+  }
+  return SCPI_RES_OK;
+}
+
+scpi_result_t __attribute__((noinline)) PerfStatsReset(scpi_t * context) {
+  (void) context;
+  perf_stats_reset();
+  return SCPI_RES_OK;
+}
+
+/* NN:PROFile:STATe switches per-operator profiling; the interpreter is
+ * re-planned as a RecordingMicroInterpreter, which costs some arena. */
+scpi_result_t __attribute__((noinline)) ProfileState(scpi_t * context) {
+  scpi_bool_t enable;
+  if (!SCPI_ParamBool(context, &enable, true)) {
+    return SCPI_RES_ERR;
+  }
+  if (tflite_set_profiling(enable) != 0) {
+    SCPI_ErrorPush(context, SCPI_ERROR_EXECUTION_ERROR);
+    return SCPI_RES_ERR;
+  }
+  return SCPI_RES_OK;
+}
+
+scpi_result_t __attribute__((noinline)) ProfileStateQ(scpi_t * context) {
+  SCPI_ResultBool(context, tflite_profiling());
+  return SCPI_RES_OK;
+}
+
+/* Pairs of operator name and mcycle count for the last inference, in
+ * execution order, then TOTAL with their sum and ARENA with the bytes of the
+ * tensor arena in use. */
+scpi_result_t __attribute__((noinline)) ProfileQ(scpi_t * context) {
+  const tflite_op_profile_t *ops;
+  if (!tflite_profiling()) {
+    SCPI_ErrorPush(context, SCPI_ERROR_EXECUTION_ERROR);
+    return SCPI_RES_ERR;
+  }
+  size_t n = tflite_profile(&ops);
+  uint64_t total = 0;
+  for (size_t i = 0; i < n; ++i) {
+    SCPI_ResultMnemonic(context, ops[i].tag);
+    SCPI_ResultUInt64(context, ops[i].cycles);
+    total += ops[i].cycles;
+  }
+  SCPI_ResultMnemonic(context, "TOTAL");
+  SCPI_ResultUInt64(context, total);
+  SCPI_ResultMnemonic(context, "ARENA");
+  SCPI_ResultUInt32(context, tflite_arena_used(NULL));
+  return SCPI_RES_OK;
+}
+
+/* RecordingMicroAllocator breakdown: name, requested bytes, used bytes and
+ * number of allocations for each kind. */
+scpi_result_t __attribute__((noinline)) ProfileArenaQ(scpi_t * context) {
+  tflite_arena_record_t records[8];
+  if (!tflite_profiling()) {
+    SCPI_ErrorPush(context, SCPI_ERROR_EXECUTION_ERROR);
+    return SCPI_RES_ERR;
+  }
+  size_t n = tflite_arena_records(records, sizeof(records) / sizeof(records[0]));
+  for (size_t i = 0; i < n; ++i) {
+    SCPI_ResultMnemonic(context, records[i].name);
+    SCPI_ResultUInt32(context, records[i].requested);
+    SCPI_ResultUInt32(context, records[i].used);
+    SCPI_ResultUInt32(context, records[i].count);
+  }
+  return SCPI_RES_OK;
+}
+
+/* Arena needs of the model: required size (the value for a generated
+ * TFLITE_ARENA_SIZE), persistent and non-persistent bytes, current size. */
+scpi_result_t __attribute__((noinline)) ArenaCalibrateQ(scpi_t * context) {
+  tflite_arena_usage_t usage;
+  if (tflite_calibrate_arena(&usage) != 0) {
+    SCPI_ErrorPush(context, SCPI_ERROR_EXECUTION_ERROR);
+    return SCPI_RES_ERR;
+  }
+  SCPI_ResultUInt32(context, usage.required);
+  SCPI_ResultUInt32(context, usage.persistent);
+  SCPI_ResultUInt32(context, usage.nonpersistent);
+  SCPI_ResultUInt32(context, usage.size);
+  return SCPI_RES_OK;
+}
+
+/* Responses are queued on the UART TX ring rather than written out: the
+ * handlers run in a trap with interrupts off, so the ring drains while
+ * scpi_server_readline() waits for the next request. */
+static void scpi_server_write(const uint8_t *data, size_t len) {
+    while (len > 0) {
+        size_t queued = uart_write_async(&uart, data, len);
+        data += queued;
+        len -= queued;
+    }
+}
+
+/* SYSTem:ECHO switches the echo of scpi_server_readline(). Clients that send
+ * binary blocks turn it off, or the echoed payload mixes with responses. */
+static scpi_bool_t scpi_server_echo = SCPI_SERVER_ECHO;
+
+scpi_result_t __attribute__((noinline)) SystemEcho(scpi_t * context) {
+    scpi_bool_t enable;
+    if (!SCPI_ParamBool(context, &enable, true)) {
+        return SCPI_RES_ERR;
+    }
+    scpi_server_echo = enable;
+    return SCPI_RES_OK;
+}
+
+scpi_result_t __attribute__((noinline)) SystemEchoQ(scpi_t * context) {
+    SCPI_ResultBool(context, scpi_server_echo);
+    return SCPI_RES_OK;
+}
+
+scpi_result_t __attribute__((noinline))  Exit(scpi_t * context) {
+    exit_scpi = 1;
+    scpi_server_write((const uint8_t *) "Exiting...\r\n", 12);
+    /* nothing polls the ring once the loop has stopped */
+    uart_flush_async(&uart);
+    return SCPI_RES_OK;
+}
+
+const scpi_command_t scpi_commands[] = {
+  { "NN:INFEr:EXAMple?", InferExample, 0},
+  { "NN:INFEr:DATA?", InferData, 0},
+  { "NN:INPut:SIZE?", InputSizeQ, 0},
+  { "FORMat:DATA", FormatData, 0},
+  { "FORMat:DATA?", FormatDataQ, 0},
+  { "PERFormance:STATistics?", PerfStatsQ, 0},
+  { "PERFormance:STATistics:RESet", PerfStatsReset, 0},
+  { "NN:PROFile:STATe", ProfileState, 0},
+  { "NN:PROFile:STATe?", ProfileStateQ, 0},
+  { "NN:PROFile?", ProfileQ, 0},
+  { "NN:PROFile:ARENa?", ProfileArenaQ, 0},
+  { "NN:ARENa:CALibrate?", ArenaCalibrateQ, 0},
+  { "SYSTem:ECHO", SystemEcho, 0},
+  { "SYSTem:ECHO?", SystemEchoQ, 0},
+  { "EXT", Exit, 0},
+  /* answered in order after everything sent before it, clients resync on it */
+  { "*OPC?", SCPI_CoreOpcQ, 0},
+	SCPI_CMD_LIST_END
+};
+
+size_t __attribute__((noinline)) scrivi(scpi_t * context, const char * data, size_t len) {
+    (void) context;
+    scpi_server_write((const uint8_t *) data, len);
+    return len;
+}
+
+int __attribute__((noinline))  SCPI_Error(scpi_t * context, int_fast16_t err) {
+    (void) context;
+    scpi_server_write((const uint8_t *) "ERR!\r\n", 6);
+    return 0;
+}
+
+scpi_result_t __attribute__((noinline)) SCPI_Control(scpi_t * context, scpi_ctrl_name_t ctrl, scpi_reg_val_t val) {
+    return SCPI_RES_OK;
+}
+scpi_result_t __attribute__((noinline)) SCPI_Reset(scpi_t * context) {
+    return SCPI_RES_OK;
+}
+scpi_result_t __attribute__((noinline))  SCPI_Flush(scpi_t * context) {
+    return SCPI_RES_OK;
+}
+
+scpi_interface_t scpi_interface = {
+	.write = scrivi,
+	.error = SCPI_Error,
+	.control = NULL,
+    .flush = NULL,
+    .reset = NULL
+};
+
+#define SCPI_INPUT_BUFFER_LENGTH 2048
+static char scpi_input_buffer[SCPI_INPUT_BUFFER_LENGTH];
+
+#define SCPI_ERROR_QUEUE_SIZE 17
+scpi_error_t scpi_error_queue_data[SCPI_ERROR_QUEUE_SIZE];
+
+/* Line editing formerly done in U-mode one ecall per byte: read until an
+ * unescaped CR/LF, echo, honour the '\\' escape, NUL terminate. */
+uint32_t scpi_server_readline(char *buf, uint32_t len) {
+    uint32_t i = 0;
+    int modifier = 0;
+
+    if (len == 0) {
+        return 0;
+    }
+    while (i < len - 1) {
+        uint8_t c;
+        while (!uart_rx_ready(&uart)) {
+            uart_tx_poll(&uart);
+        }
+        uart_getchar(&uart, &c);
+        if (c == '\\') {
+            if (!modifier) modifier = 1;
+            else {
+                buf[i++] = c;
+                modifier = 0;
+            }
+            continue;
+        }
+        if (scpi_server_echo) {
+            uint8_t echo[2] = { c, c == '\n' ? '\r' : '\n' };
+            scpi_server_write(echo, (c == '\n' || c == '\r') ? 2 : 1);
+        }
+        if ((c == '\n' || c == '\r') && !modifier) {
+            break;
+        }
+        buf[i++] = c;
+        modifier = 0;
+    }
+    buf[i] = '\0';
+    return i;
+}
+
+void scpi_server_input(const char *input, uint32_t len) {
+    if (len > 0) {
+        perf_region_begin(kPerfRegionScpiInput);
+        SCPI_Input(&scpi_context, input, len);
+#if USE_BLOCK_SINK
+        /* a streamed block may span several lines */
+        if (SCPI_InputBlockPending(&scpi_context)) {
+            perf_region_end(kPerfRegionScpiInput);
+            return;
+        }
+#endif
+        SCPI_Input(&scpi_context, "\r\n", 2);
+        perf_region_end(kPerfRegionScpiInput);
+    }
+    SCPI_Flush(&scpi_context);
+}
+
+void scpi_server_init(void) {
+    SCPI_Init(&scpi_context, 
+              scpi_commands, 
+              &scpi_interface, 
+              scpi_units_def, 
+              SCPI_IDN1, SCPI_IDN2, SCPI_IDN3, SCPI_IDN4, 
+              scpi_input_buffer, SCPI_INPUT_BUFFER_LENGTH,
+              scpi_error_queue_data, SCPI_ERROR_QUEUE_SIZE);
+    SCPI_SetBlockSink(&scpi_context, "NN:INFEr:DATA?", InferDataSink);
+
+  printf("Initialized x.ruSCPI\r\n");
+  // Print available SCPI commands
+  printf("Available SCPI commands:\r\n");
+  for (int i = 0; scpi_commands[i].pattern != NULL; i++) {
+    printf("%s\r\n", scpi_commands[i].pattern);
+  }
+}
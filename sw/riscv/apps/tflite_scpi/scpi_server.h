@@ -0,0 +1,55 @@
+// Copyright EPFL contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef SCPI_SERVER_H
+#define SCPI_SERVER_H
+
+#include <stdint.h>
+#include "perf_region.h"
+#include "scpi/scpi.h"
+#include "uart.h"
+
+/* Whether scpi_server_readline() echoes received characters at startup;
+ * SYSTem:ECHO changes it at run time */
+#ifndef SCPI_SERVER_ECHO
+#define SCPI_SERVER_ECHO 1
+#endif
+
+/* Region ids of the application, in PERFormance:STATistics? and for the host
+ * sampler. kRegionDoorbell is measured from U-mode around a whole ring
+ * doorbell, kPerfRegionScpiInput in M-mode around each line it parses. */
+enum {
+  kRegionInvoke   = kPerfRegionUser,
+  kRegionFormat   = kPerfRegionUser + 1,
+  kRegionDoorbell = kPerfRegionUser + 2,
+};
+
+/* Defined by the application (main.c on the board, the host simulator) */
+extern uart_t uart;
+extern volatile int exit_scpi;
+
+extern scpi_t scpi_context;
+
+scpi_result_t SCPI_Flush(scpi_t * context);
+
+/**
+ * Register the commands and the NN:INFEr:DATA? block sink on scpi_context.
+ */
+void scpi_server_init(void);
+
+/**
+ * Read one line from the UART into buf (at most len-1 bytes, NUL terminated).
+ * '\\' escapes the next character, so "\\\n" stores a newline instead of
+ * ending the line.
+ * @return The number of bytes stored, without the NUL.
+ */
+uint32_t scpi_server_readline(char *buf, uint32_t len);
+
+/**
+ * Feed one line to the parser and terminate the program message, unless a
+ * streamed block is still being received.
+ */
+void scpi_server_input(const char *input, uint32_t len);
+
+#endif
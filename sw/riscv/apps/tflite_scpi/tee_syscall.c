@@ -0,0 +1,143 @@
+// Copyright EPFL contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+/* M-mode side of the U-mode system calls declared in tee_syscall.h */
+
+#include "tee_syscall.h"
+#include "handler.h"
+#include "uart.h"
+#include <stdio.h>
+#include "scpi_server.h"
+#include "perf_stats.h"
+
+/* Accept a user buffer only if it lies entirely inside the ram2 sandbox. */
+static int user_buffer_ok(uintptr_t ptr, uint32_t len) {
+    return (ptr >= TEE_RAM2_LO) && (ptr <= TEE_RAM2_HI) &&
+           (len <= TEE_RAM2_HI - ptr);
+}
+
+/* Line reader shared with the host build; flags further waiting input */
+static uint32_t uart_readline(char *buf, uint32_t len) {
+    uint32_t i = scpi_server_readline(buf, len);
+    return uart_rx_ready(&uart) ? (i | TEE_READLINE_MORE) : i;
+}
+
+static uint32_t tee_sys_infer(uintptr_t ptr, uint32_t len) {
+    if (!user_buffer_ok(ptr, len)) {
+        printf("[M] Bad user buffer (0x%08lx, len=%u)\r\n", (long)ptr, len);
+        return 0;
+    }
+    scpi_server_input((const char *)ptr, len);
+    return 0;
+}
+
+static uint32_t tee_sys_ring_doorbell(uintptr_t ptr, uint32_t unused) {
+    tee_ring_t *ring = (tee_ring_t *)ptr;
+    if (!user_buffer_ok(ptr, sizeof(*ring)) || (ptr & 3)) {
+        printf("[M] Bad user buffer (0x%08lx, len=%u)\r\n", (long)ptr, (unsigned)sizeof(*ring));
+        return 0;
+    }
+
+    /* ram2 is writable by U-mode: read each shared field once */
+    uint32_t head = ring->head;
+    uint32_t tail = ring->tail;
+    if (head - tail > TEE_RING_SLOTS) {
+        printf("[M] Bad ring indices (head=%u, tail=%u)\r\n", head, tail);
+        ring->tail = head;
+        return 0;
+    }
+
+    uint32_t done = 0;
+    for (; tail != head; ++tail) {
+        tee_ring_desc_t *desc = &ring->desc[tail % TEE_RING_SLOTS];
+        uintptr_t buf = desc->ptr;
+        uint32_t len = desc->len;
+        if (!user_buffer_ok(buf, len)) {
+            desc->status = TEE_RING_BAD_BUFFER;
+            continue;
+        }
+        scpi_server_input((const char *)buf, len);
+        desc->status = TEE_RING_DONE;
+        done++;
+    }
+    ring->tail = tail;
+    return done;
+}
+
+static uint32_t tee_sys_uart_putchar(uintptr_t c, uint32_t unused) {
+    uart_putchar(&uart, (uint8_t)c);
+    return 0;
+}
+
+static uint32_t tee_sys_uart_getchar(uintptr_t unused0, uint32_t unused1) {
+    uint8_t c;
+    uart_getchar(&uart, &c);
+    return c;
+}
+
+static uint32_t tee_sys_uart_readline(uintptr_t ptr, uint32_t len) {
+    if (!user_buffer_ok(ptr, len)) {
+        printf("[M] Bad user buffer (0x%08lx, len=%u)\r\n", (long)ptr, len);
+        return 0;
+    }
+    return uart_readline((char *)ptr, len);
+}
+
+static uint32_t tee_sys_uart_write(uintptr_t ptr, uint32_t len) {
+    if (!user_buffer_ok(ptr, len)) {
+        printf("[M] Bad user buffer (0x%08lx, len=%u)\r\n", (long)ptr, len);
+        return 0;
+    }
+    return uart_write(&uart, (const uint8_t *)ptr, len);
+}
+
+/* Start readings of tee_counters_start(), kept out of ram2 */
+static perf_counters_t counters_start[PERF_STATS_REGIONS];
+static uint8_t counters_started[PERF_STATS_REGIONS];
+
+static uint32_t tee_sys_read_counters(uintptr_t ptr, uint32_t arg) {
+    /* read first, so that the checks below are outside the window */
+    perf_counters_t now;
+    perf_counters_read(&now);
+
+    uint32_t region = arg & ~TEE_COUNTERS_START;
+    if (region == 0 || region >= PERF_STATS_REGIONS) {
+        printf("[M] Bad counter region %u\r\n", region);
+        return 0;
+    }
+    if (arg & TEE_COUNTERS_START) {
+        counters_started[region] = 1;
+        /* and last here, for the same reason */
+        perf_counters_read(&counters_start[region]);
+        return 0;
+    }
+
+    tee_counters_t *c = (tee_counters_t *)ptr;
+    if (!user_buffer_ok(ptr, sizeof(*c)) || (ptr & 3)) {
+        printf("[M] Bad user buffer (0x%08lx, len=%u)\r\n", (long)ptr, (unsigned)sizeof(*c));
+        return 0;
+    }
+    if (!counters_started[region]) {
+        return 0;
+    }
+    counters_started[region] = 0;
+
+    perf_counters_t delta;
+    delta.cycles = now.cycles - counters_start[region].cycles;
+    delta.instret = now.instret - counters_start[region].instret;
+    perf_stats_record(region, &delta);
+    c->delta = delta;
+    return 0;
+}
+
+/* dispatched by syscall_entry (crt/syscall_entry.S) on the id in a7 */
+HANDLER_SYSCALL_TABLE(
+    [TEE_EC_INFER]         = tee_sys_infer,
+    [TEE_EC_UART_PUTCHAR]  = tee_sys_uart_putchar,
+    [TEE_EC_UART_GETCHAR]  = tee_sys_uart_getchar,
+    [TEE_EC_UART_READLINE] = tee_sys_uart_readline,
+    [TEE_EC_UART_WRITE]    = tee_sys_uart_write,
+    [TEE_EC_RDCOUNTERS]    = tee_sys_read_counters,
+    [TEE_EC_RING_DOORBELL] = tee_sys_ring_doorbell,
+);
@@ -2,12 +2,52 @@
 #pragma once
 #include <stdint.h>
 #include <stddef.h>
+#include "perf_stats.h"
 
-/* --- numeric IDs seen in a7 --- */
+/* --- numeric IDs seen in a7, indexing handler_syscall_table (tee_syscall.c);
+ * every call returns in a0 and preserves all other registers --- */
 #define TEE_EC_INFER          0
 #define TEE_EC_UART_PUTCHAR   1
 #define TEE_EC_UART_GETCHAR   2
-#define TEE_EC_RDCOUNTERS     99
+#define TEE_EC_UART_READLINE  3
+#define TEE_EC_UART_WRITE     4
+#define TEE_EC_RDCOUNTERS     5
+#define TEE_EC_RING_DOORBELL  6
+
+/* --- user sandbox (ram2 in link.ld) every buffer must stay inside --- */
+#define TEE_RAM2_LO           0x00078000
+#define TEE_RAM2_HI           0x00080000
+
+/* --- set in the TEE_EC_UART_READLINE result when more input is waiting --- */
+#define TEE_READLINE_MORE     0x80000000u
+
+/* --- set in the TEE_EC_RDCOUNTERS region argument to start a measurement --- */
+#define TEE_COUNTERS_START    0x80000000u
+
+/* --- request ring: TEE_RING_SLOTS lines of up to TEE_RING_LINE bytes --- */
+#define TEE_RING_SLOTS        4
+#define TEE_RING_LINE         2048
+
+/* Descriptor status, written back by M-mode */
+#define TEE_RING_PENDING      0
+#define TEE_RING_DONE         1
+#define TEE_RING_BAD_BUFFER   2
+
+/* Single-producer/single-consumer ring in ram2. U-mode fills desc[head %
+ * TEE_RING_SLOTS] and increments head; one TEE_EC_RING_DOORBELL makes M-mode
+ * feed every pending line to the SCPI parser in order, write back each
+ * status and advance tail up to head. Indices are free running. */
+typedef struct tee_ring_desc {
+    uint32_t ptr;
+    uint32_t len;
+    uint32_t status;
+} tee_ring_desc_t;
+
+typedef struct tee_ring {
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    tee_ring_desc_t desc[TEE_RING_SLOTS];
+} tee_ring_t;
 
 /* ------------- U-side API (lives in .user_text) ------------- */
 __attribute__((section(".user_text"), aligned(4), noinline))
@@ -19,7 +59,8 @@ static inline void tee_infer(const void *buf, size_t len)
 
     __asm__ volatile (
         "ecall"
-        :: "r" (syscall_id), "r" (buf_ptr), "r" (len_val)
+        : "+r" (buf_ptr)
+        : "r" (syscall_id), "r" (len_val)
         : "memory"
     );
 }
@@ -33,7 +74,8 @@ static inline void tee_uart_putchar(uint8_t c)
 
     __asm__ volatile (
         "ecall"
-        :: "r" (syscall_id), "r" (c_val), "r" (dummy)
+        : "+r" (c_val)
+        : "r" (syscall_id), "r" (dummy)
         : "memory"
     );
 }
@@ -48,22 +90,104 @@ static inline uint8_t tee_uart_getchar(void)
     
     __asm__ volatile (
         "ecall"
-        : "=r" (dummy)
-        : "r" (syscall_id), "r" (dummy), "r" (dummy2)
+        : "+r" (dummy)
+        : "r" (syscall_id), "r" (dummy2)
         : "memory"
     );
     ch = dummy;
     return (uint8_t)ch;
 }
 
+/* Result of a counter measurement, in ram2. The start reading stays in
+ * M-mode, one per region, so U-mode cannot forge the recorded deltas;
+ * measurements of different regions may nest. */
+typedef struct tee_counters {
+    perf_counters_t delta;
+} tee_counters_t;
+
+__attribute__((section(".user_text"), aligned(4), noinline))
+static inline void tee_read_counters(tee_counters_t *c, uint32_t region)
+{
+    register uint32_t syscall_id __asm__("a7") = TEE_EC_RDCOUNTERS;
+    register tee_counters_t *c_ptr __asm__("a0") = c;
+    register uint32_t region_val __asm__("a1") = region;
+
+    __asm__ volatile (
+        "ecall"
+        : "+r" (c_ptr)
+        : "r" (syscall_id), "r" (region_val)
+        : "memory"
+    );
+}
+
+/* Start a measurement of region (1 to PERF_STATS_REGIONS - 1): M-mode keeps
+ * the mcycle/minstret reading. Nothing is printed, so the trap only costs
+ * the CSR reads. */
+__attribute__((section(".user_text"), aligned(4), noinline))
+static inline void tee_counters_start(uint32_t region)
+{
+    tee_read_counters(NULL, region | TEE_COUNTERS_START);
+}
+
+/* Stop a measurement: add the 64-bit deltas since tee_counters_start() of
+ * the same region to its M-mode statistics (see PERFormance:STATistics?) and
+ * copy them to c->delta. */
+__attribute__((section(".user_text"), aligned(4), noinline))
+static inline void tee_counters_stop(tee_counters_t *c, uint32_t region)
+{
+    tee_read_counters(c, region);
+}
+
+/* Read one line into buf (at most len-1 bytes, NUL terminated) in a single
+ * trap. '\\' escapes the next character, so "\\\n" stores a newline instead
+ * of ending the line. Returns the number of bytes stored, without the NUL,
+ * or'ed with TEE_READLINE_MORE if further input is already waiting. */
+__attribute__((section(".user_text"), aligned(4), noinline))
+static inline size_t tee_uart_readline(char *buf, size_t len)
+{
+    register uint32_t syscall_id __asm__("a7") = TEE_EC_UART_READLINE;
+    register char *buf_ptr __asm__("a0") = buf;
+    register uint32_t len_val __asm__("a1") = (uint32_t)len;
+
+    __asm__ volatile (
+        "ecall"
+        : "+r" (buf_ptr)
+        : "r" (syscall_id), "r" (len_val)
+        : "memory"
+    );
+    return (size_t)(uintptr_t)buf_ptr;
+}
+
+/* Write len bytes from buf to the UART in a single trap. */
 __attribute__((section(".user_text"), aligned(4), noinline))
-static inline void tee_read_counters_arr(void)
+static inline void tee_uart_write(const void *buf, size_t len)
 {
-    register uint32_t syscall_id __asm__("a7") = TEE_EC_RDCOUNTERS;  
+    register uint32_t syscall_id __asm__("a7") = TEE_EC_UART_WRITE;
+    register const void *buf_ptr __asm__("a0") = buf;
+    register uint32_t len_val __asm__("a1") = (uint32_t)len;
+
+    __asm__ volatile (
+        "ecall"
+        : "+r" (buf_ptr)
+        : "r" (syscall_id), "r" (len_val)
+        : "memory"
+    );
+}
+
+/* Hand every pending descriptor of ring to M-mode in a single trap. Returns
+ * the number of lines processed. */
+__attribute__((section(".user_text"), aligned(4), noinline))
+static inline uint32_t tee_ring_doorbell(tee_ring_t *ring)
+{
+    register uint32_t syscall_id __asm__("a7") = TEE_EC_RING_DOORBELL;
+    register tee_ring_t *ring_ptr __asm__("a0") = ring;
+    register uint32_t dummy __asm__("a1") = 0;
 
     __asm__ volatile (
         "ecall"
-        :: "r" (syscall_id)
+        : "+r" (ring_ptr)
+        : "r" (syscall_id), "r" (dummy)
         : "memory"
     );
+    return (uint32_t)(uintptr_t)ring_ptr;
 }
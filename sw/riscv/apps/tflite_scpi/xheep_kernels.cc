@@ -0,0 +1,140 @@
+// Copyright EPFL contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "xheep_kernels.h"
+
+#include "tensorflow/lite/c/builtin_op_data.h"
+#include "tensorflow/lite/core/c/common.h"
+#include "tensorflow/lite/micro/kernels/kernel_util.h"
+#include "xheep_nn.h"
+
+namespace tflite {
+namespace {
+
+using InvokeFn = TfLiteStatus (*)(TfLiteContext*, TfLiteNode*);
+
+// The reference Invoke, for the cases xheep_nn does not handle
+InvokeFn reference_conv_invoke = nullptr;
+InvokeFn reference_fc_invoke = nullptr;
+
+TfLiteStatus XheepConvInvoke(TfLiteContext* context, TfLiteNode* node) {
+  const TfLiteEvalTensor* input =
+      micro::GetEvalInput(context, node, kConvInputTensor);
+  const TfLiteEvalTensor* filter =
+      micro::GetEvalInput(context, node, kConvWeightsTensor);
+  const TfLiteEvalTensor* bias =
+      node->inputs->size == 3
+          ? micro::GetEvalInput(context, node, kConvBiasTensor)
+          : nullptr;
+  TfLiteEvalTensor* output =
+      micro::GetEvalOutput(context, node, kConvOutputTensor);
+
+  const RuntimeShape input_shape = micro::GetTensorShape(input);
+  const RuntimeShape filter_shape = micro::GetTensorShape(filter);
+  const RuntimeShape output_shape = micro::GetTensorShape(output);
+  if (input->type != kTfLiteInt8 || filter->type != kTfLiteInt8 ||
+      output->type != kTfLiteInt8 ||
+      (bias != nullptr && bias->type != kTfLiteInt32) ||
+      input_shape.Dims(3) != filter_shape.Dims(3)) {
+    return reference_conv_invoke(context, node);
+  }
+
+  const auto& params =
+      *static_cast<const TfLiteConvParams*>(node->builtin_data);
+  const auto& data = *static_cast<const OpDataConv*>(node->user_data);
+  const ConvParams op_params = ConvParamsQuantized(params, data);
+
+  xheep_conv_s8_params_t p;
+  p.batches = input_shape.Dims(0);
+  p.input_h = input_shape.Dims(1);
+  p.input_w = input_shape.Dims(2);
+  p.input_c = input_shape.Dims(3);
+  p.filter_h = filter_shape.Dims(1);
+  p.filter_w = filter_shape.Dims(2);
+  p.output_h = output_shape.Dims(1);
+  p.output_w = output_shape.Dims(2);
+  p.output_c = output_shape.Dims(3);
+  p.stride_h = op_params.stride_height;
+  p.stride_w = op_params.stride_width;
+  p.dilation_h = op_params.dilation_height_factor;
+  p.dilation_w = op_params.dilation_width_factor;
+  p.pad_h = op_params.padding_values.height;
+  p.pad_w = op_params.padding_values.width;
+  p.input_offset = op_params.input_offset;
+  p.output_offset = op_params.output_offset;
+  p.act_min = op_params.quantized_activation_min;
+  p.act_max = op_params.quantized_activation_max;
+  p.multiplier = data.per_channel_output_multiplier;
+  p.shift = data.per_channel_output_shift;
+
+  xheep_conv_s8(&p, micro::GetTensorData<int8_t>(input),
+                micro::GetTensorData<int8_t>(filter),
+                bias != nullptr ? micro::GetTensorData<int32_t>(bias) : nullptr,
+                micro::GetTensorData<int8_t>(output));
+  return kTfLiteOk;
+}
+
+TfLiteStatus XheepFullyConnectedInvoke(TfLiteContext* context,
+                                       TfLiteNode* node) {
+  const TfLiteEvalTensor* input =
+      micro::GetEvalInput(context, node, kFullyConnectedInputTensor);
+  const TfLiteEvalTensor* filter =
+      micro::GetEvalInput(context, node, kFullyConnectedWeightsTensor);
+  const TfLiteEvalTensor* bias =
+      node->inputs->size == 3
+          ? micro::GetEvalInput(context, node, kFullyConnectedBiasTensor)
+          : nullptr;
+  TfLiteEvalTensor* output =
+      micro::GetEvalOutput(context, node, kFullyConnectedOutputTensor);
+
+  if (input->type != kTfLiteInt8 || filter->type != kTfLiteInt8 ||
+      output->type != kTfLiteInt8 ||
+      (bias != nullptr && bias->type != kTfLiteInt32)) {
+    return reference_fc_invoke(context, node);
+  }
+
+  const auto& data =
+      *static_cast<const OpDataFullyConnected*>(node->user_data);
+  const FullyConnectedParams op_params = FullyConnectedParamsQuantized(data);
+  const RuntimeShape filter_shape = micro::GetTensorShape(filter);
+  const RuntimeShape output_shape = micro::GetTensorShape(output);
+  const int output_dims = output_shape.DimensionsCount();
+
+  xheep_fc_s8_params_t p;
+  p.output_depth = output_shape.Dims(output_dims - 1);
+  p.batches = output_shape.FlatSize() / p.output_depth;
+  p.accum_depth = filter_shape.Dims(filter_shape.DimensionsCount() - 1);
+  p.input_offset = op_params.input_offset;
+  p.filter_offset = op_params.weights_offset;
+  p.output_offset = op_params.output_offset;
+  p.multiplier = op_params.output_multiplier;
+  p.shift = op_params.output_shift;
+  p.act_min = op_params.quantized_activation_min;
+  p.act_max = op_params.quantized_activation_max;
+
+  xheep_fully_connected_s8(
+      &p, micro::GetTensorData<int8_t>(input),
+      micro::GetTensorData<int8_t>(filter),
+      bias != nullptr ? micro::GetTensorData<int32_t>(bias) : nullptr,
+      micro::GetTensorData<int8_t>(output));
+  return kTfLiteOk;
+}
+
+}  // namespace
+
+decltype(Register_CONV_2D()) Register_XHEEP_CONV_2D() {
+  auto registration = Register_CONV_2D();
+  reference_conv_invoke = registration.invoke;
+  registration.invoke = XheepConvInvoke;
+  return registration;
+}
+
+decltype(Register_FULLY_CONNECTED()) Register_XHEEP_FULLY_CONNECTED() {
+  auto registration = Register_FULLY_CONNECTED();
+  reference_fc_invoke = registration.invoke;
+  registration.invoke = XheepFullyConnectedInvoke;
+  return registration;
+}
+
+}  // namespace tflite
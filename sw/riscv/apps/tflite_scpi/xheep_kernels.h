@@ -0,0 +1,22 @@
+// Copyright EPFL contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef XHEEP_KERNELS_H
+#define XHEEP_KERNELS_H
+
+#include "tensorflow/lite/micro/kernels/conv.h"
+#include "tensorflow/lite/micro/kernels/fully_connected.h"
+
+namespace tflite {
+
+// CONV_2D and FULLY_CONNECTED with the int8 paths of xheep_nn.c. Init and
+// Prepare are the reference kernels', so the op data and the arena plan are
+// unchanged; tensor types or layouts xheep_nn does not cover are handed to
+// the reference Invoke. Pass them to AddConv2D() / AddFullyConnected().
+decltype(Register_CONV_2D()) Register_XHEEP_CONV_2D();
+decltype(Register_FULLY_CONNECTED()) Register_XHEEP_FULLY_CONNECTED();
+
+}  // namespace tflite
+
+#endif
@@ -0,0 +1,197 @@
+// Copyright EPFL contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "xheep_nn.h"
+
+#include <stddef.h>
+#include <string.h>
+
+/* Four int8 values in one load. The X-HEEP cores split misaligned loads in
+ * hardware, so a plain lw is used whatever the alignment; elsewhere memcpy
+ * keeps it defined behaviour. */
+static inline uint32_t xheep_load_s8x4(const int8_t *p) {
+  uint32_t word;
+#if defined(__riscv)
+  __asm__("lw %0, 0(%1)" : "=r"(word) : "r"(p), "m"(*(const int8_t(*)[4])p));
+#else
+  memcpy(&word, p, sizeof(word));
+#endif
+  return word;
+}
+
+/* Byte i (little endian) of a packed word, sign extended */
+#define XHEEP_S8(word, i) ((int32_t)((word) << (24 - 8 * (i))) >> 24)
+
+static int32_t xheep_dot_s8(const int8_t *a, const int8_t *b, int len) {
+  int32_t acc = 0;
+  int i = 0;
+  for (; i + 4 <= len; i += 4) {
+    uint32_t wa = xheep_load_s8x4(a + i);
+    uint32_t wb = xheep_load_s8x4(b + i);
+    acc += XHEEP_S8(wa, 0) * XHEEP_S8(wb, 0);
+    acc += XHEEP_S8(wa, 1) * XHEEP_S8(wb, 1);
+    acc += XHEEP_S8(wa, 2) * XHEEP_S8(wb, 2);
+    acc += XHEEP_S8(wa, 3) * XHEEP_S8(wb, 3);
+  }
+  for (; i < len; ++i) {
+    acc += a[i] * b[i];
+  }
+  return acc;
+}
+
+static int32_t xheep_sum_s8(const int8_t *a, int len) {
+  int32_t sum = 0;
+  int i = 0;
+  for (; i + 4 <= len; i += 4) {
+    uint32_t wa = xheep_load_s8x4(a + i);
+    sum += XHEEP_S8(wa, 0) + XHEEP_S8(wa, 1) + XHEEP_S8(wa, 2) +
+           XHEEP_S8(wa, 3);
+  }
+  for (; i < len; ++i) {
+    sum += a[i];
+  }
+  return sum;
+}
+
+static inline int32_t xheep_clamp(int32_t v, int32_t lo, int32_t hi) {
+  return v < lo ? lo : (v > hi ? hi : v);
+}
+
+int32_t xheep_requantize(int32_t acc, int32_t multiplier, int shift) {
+#ifdef TFLITE_SINGLE_ROUNDING
+  int total_shift = 31 - shift;
+  int64_t result = (int64_t)acc * multiplier + ((int64_t)1 << (total_shift - 1));
+  return (int32_t)(result >> total_shift);
+#else
+  int left_shift = shift > 0 ? shift : 0;
+  int right_shift = shift > 0 ? 0 : -shift;
+  int32_t a = (int32_t)((uint32_t)acc << left_shift);
+
+  // SaturatingRoundingDoublingHighMul: the reference divides by 2^31,
+  // rounding toward zero, which is a biased arithmetic shift
+  int32_t high;
+  if (a == INT32_MIN && multiplier == INT32_MIN) {
+    high = INT32_MAX;
+  } else {
+    int64_t ab = (int64_t)a * multiplier;
+    if (ab >= 0) {
+      high = (int32_t)((ab + (1 << 30)) >> 31);
+    } else {
+      high = (int32_t)((ab + (1 - (1 << 30)) + (((int64_t)1 << 31) - 1)) >> 31);
+    }
+  }
+
+  // RoundingDivideByPOT
+  int32_t mask = (int32_t)(((int64_t)1 << right_shift) - 1);
+  int32_t remainder = high & mask;
+  int32_t threshold = (mask >> 1) + (high < 0 ? 1 : 0);
+  return (high >> right_shift) + (remainder > threshold ? 1 : 0);
+#endif
+}
+
+void xheep_conv_s8(const xheep_conv_s8_params_t *p, const int8_t *input,
+                   const int8_t *filter, const int32_t *bias, int8_t *output) {
+  const int ic = p->input_c;
+  const int row_len = p->filter_w * ic;
+  const int filter_size = p->filter_h * row_len;
+  const int in_row_stride = p->input_w * ic;
+
+  for (int b = 0; b < p->batches; ++b) {
+    const int8_t *in = input + (size_t)b * p->input_h * in_row_stride;
+    int8_t *out = output + (size_t)b * p->output_h * p->output_w * p->output_c;
+
+    for (int oc = 0; oc < p->output_c; ++oc) {
+      const int8_t *f = filter + (size_t)oc * filter_size;
+      const int32_t full_sum = xheep_sum_s8(f, filter_size);
+      const int32_t bias_oc = bias != NULL ? bias[oc] : 0;
+
+      for (int oy = 0; oy < p->output_h; ++oy) {
+        const int iy0 = oy * p->stride_h - p->pad_h;
+        const int y_inside =
+            iy0 >= 0 && iy0 + (p->filter_h - 1) * p->dilation_h < p->input_h;
+
+        for (int ox = 0; ox < p->output_w; ++ox) {
+          const int ix0 = ox * p->stride_w - p->pad_w;
+          const int inside = y_inside && ix0 >= 0 &&
+              ix0 + (p->filter_w - 1) * p->dilation_w < p->input_w;
+          int32_t acc = 0;
+          int32_t filter_sum = 0;
+
+          for (int fy = 0; fy < p->filter_h; ++fy) {
+            const int iy = iy0 + fy * p->dilation_h;
+            if (iy < 0 || iy >= p->input_h) {
+              continue;
+            }
+            const int8_t *in_row = in + (size_t)iy * in_row_stride;
+            const int8_t *f_row = f + fy * row_len;
+
+            if (p->dilation_w == 1) {
+              // Taps of a filter row inside the image are one contiguous run
+              int fx0 = ix0 < 0 ? -ix0 : 0;
+              int fx1 = p->input_w - ix0 < p->filter_w ? p->input_w - ix0
+                                                       : p->filter_w;
+              if (fx1 <= fx0) {
+                continue;
+              }
+              int len = (fx1 - fx0) * ic;
+              acc += xheep_dot_s8(in_row + (ix0 + fx0) * ic, f_row + fx0 * ic,
+                                  len);
+              if (!inside) {
+                filter_sum += xheep_sum_s8(f_row + fx0 * ic, len);
+              }
+            } else {
+              for (int fx = 0; fx < p->filter_w; ++fx) {
+                const int ix = ix0 + fx * p->dilation_w;
+                if (ix < 0 || ix >= p->input_w) {
+                  continue;
+                }
+                acc += xheep_dot_s8(in_row + ix * ic, f_row + fx * ic, ic);
+                if (!inside) {
+                  filter_sum += xheep_sum_s8(f_row + fx * ic, ic);
+                }
+              }
+            }
+          }
+
+          // sum(f * (x + offset)) == sum(f * x) + offset * sum(f)
+          acc += p->input_offset * (inside ? full_sum : filter_sum);
+          acc += bias_oc;
+          acc = xheep_requantize(acc, p->multiplier[oc], p->shift[oc]);
+          acc = xheep_clamp(acc + p->output_offset, p->act_min, p->act_max);
+          out[((size_t)oy * p->output_w + ox) * p->output_c + oc] = (int8_t)acc;
+        }
+      }
+    }
+  }
+}
+
+void xheep_fully_connected_s8(const xheep_fc_s8_params_t *p,
+                              const int8_t *input, const int8_t *filter,
+                              const int32_t *bias, int8_t *output) {
+  const int n = p->accum_depth;
+
+  for (int b = 0; b < p->batches; ++b) {
+    const int8_t *in = input + (size_t)b * n;
+    // sum((w + fo) * (x + io)) ==
+    //   sum(w * x) + io * sum(w) + fo * sum(x) + n * io * fo
+    const int32_t input_term =
+        p->filter_offset != 0
+            ? p->filter_offset * (xheep_sum_s8(in, n) + n * p->input_offset)
+            : 0;
+
+    for (int o = 0; o < p->output_depth; ++o) {
+      const int8_t *w = filter + (size_t)o * n;
+      int32_t acc = xheep_dot_s8(in, w, n) + input_term;
+      if (p->input_offset != 0) {
+        acc += p->input_offset * xheep_sum_s8(w, n);
+      }
+      if (bias != NULL) {
+        acc += bias[o];
+      }
+      acc = xheep_requantize(acc, p->multiplier, p->shift);
+      acc = xheep_clamp(acc + p->output_offset, p->act_min, p->act_max);
+      output[(size_t)b * p->output_depth + o] = (int8_t)acc;
+    }
+  }
+}
@@ -0,0 +1,84 @@
+// Copyright EPFL contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef XHEEP_NN_H
+#define XHEEP_NN_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * int8 Conv2D and FullyConnected for cores without SIMD, bit-exact with the
+ * TFLM reference_integer_ops kernels. Tensors are NHWC, filters OHWI.
+ *
+ * Rows of the filter window are contiguous in memory, so convolutions are
+ * computed row by row without an im2col buffer; the dot products load four
+ * int8 values per 32-bit access. The input offset is applied once per output
+ * from the filter sum instead of once per MAC.
+ */
+
+/**
+ * Conv2D parameters, as in tflite::ConvParams plus the tensor dimensions.
+ * Grouped convolutions (filter depth != input depth) are not supported.
+ */
+typedef struct xheep_conv_s8_params {
+  int batches;
+  int input_h, input_w, input_c;
+  int filter_h, filter_w;
+  int output_h, output_w, output_c;
+  int stride_h, stride_w;
+  int dilation_h, dilation_w;
+  int pad_h, pad_w;
+  int32_t input_offset;   // -input zero point
+  int32_t output_offset;  // output zero point
+  int32_t act_min, act_max;
+  const int32_t *multiplier;  // Per output channel
+  const int32_t *shift;       // Per output channel
+} xheep_conv_s8_params_t;
+
+/**
+ * FullyConnected parameters, as in tflite::FullyConnectedParams.
+ */
+typedef struct xheep_fc_s8_params {
+  int batches;
+  int accum_depth;
+  int output_depth;
+  int32_t input_offset;   // -input zero point
+  int32_t filter_offset;  // -filter zero point
+  int32_t output_offset;  // output zero point
+  int32_t multiplier;
+  int shift;
+  int32_t act_min, act_max;
+} xheep_fc_s8_params_t;
+
+/**
+ * tflite::MultiplyByQuantizedMultiplier(), without 64-bit divisions. Builds
+ * with TFLITE_SINGLE_ROUNDING follow the single-rounding variant, which must
+ * match the TFLM library the model runs against.
+ */
+int32_t xheep_requantize(int32_t acc, int32_t multiplier, int shift);
+
+/**
+ * Per-channel quantized int8 convolution.
+ * @param bias Per output channel, may be NULL.
+ */
+void xheep_conv_s8(const xheep_conv_s8_params_t *p, const int8_t *input,
+                   const int8_t *filter, const int32_t *bias, int8_t *output);
+
+/**
+ * Per-tensor quantized int8 fully-connected layer.
+ * @param bias Per output, may be NULL.
+ */
+void xheep_fully_connected_s8(const xheep_fc_s8_params_t *p,
+                              const int8_t *input, const int8_t *filter,
+                              const int32_t *bias, int8_t *output);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
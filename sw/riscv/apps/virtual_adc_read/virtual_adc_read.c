@@ -20,6 +20,7 @@
 #include "spi_host.h"
 #include "spi_host_regs.h"
 #include "dma.h"
+#include "dma_queue.h"
 #include "fast_intr_ctrl.h"
 #include "gpio.h"
 #include "fast_intr_ctrl_regs.h"
@@ -28,19 +29,9 @@
 #define FLASH_ADDR 0x00000000
 #define FLASH_CLK_MAX_HZ (133 * 1000 * 1000)
 
-volatile int8_t dma_intr_flag;
-
 spi_host_t spi_host_flash;
 
-void handler_irq_fast_dma(void)
-{
-    fast_intr_ctrl_t fast_intr_ctrl;
-    fast_intr_ctrl.base_addr = mmio_region_from_addr((uintptr_t)FAST_INTR_CTRL_START_ADDRESS);
-    clear_fast_interrupt(&fast_intr_ctrl, kDma_fic_e);
-    dma_intr_flag = 1;
-}
-
-void read_from_flash(spi_host_t *SPI, dma_t *DMA, uint32_t *data, uint32_t byte_count, uint32_t addr)
+void read_from_flash(spi_host_t *SPI, uint32_t *data, uint32_t byte_count, uint32_t addr)
 {
     uint32_t read_from_mem = 0x0b;
     spi_write_word(SPI, read_from_mem);
@@ -91,14 +82,9 @@ void read_from_flash(spi_host_t *SPI, dma_t *DMA, uint32_t *data, uint32_t byte_
 
     uint32_t *fifo_ptr_rx = SPI->base_addr.base + SPI_HOST_RXDATA_REG_OFFSET;
 
-    dma_set_read_ptr_inc(DMA, (uint32_t) 0);
-    dma_set_write_ptr_inc(DMA, (uint32_t) 4);
-    dma_set_read_ptr(DMA, (uint32_t) fifo_ptr_rx);
-    dma_set_write_ptr(DMA, (uint32_t) data);
-
-    dma_set_spi_mode(DMA, (uint32_t) 1);
-    dma_set_data_type(DMA, (uint32_t) 0);
-    dma_set_cnt_start(DMA, (uint32_t) byte_count);
+    dma_desc_t desc;
+    dma_desc_spi_rx(&desc, kDmaQueueSpiRxToMem_e, data, fifo_ptr_rx, byte_count, NULL, NULL);
+    dma_queue_submit(&desc);
 
     const uint32_t cmd_read_rx = spi_create_command((spi_command_t){
         .len       = byte_count - 1,
@@ -109,9 +95,7 @@ void read_from_flash(spi_host_t *SPI, dma_t *DMA, uint32_t *data, uint32_t byte_
     spi_set_command(SPI, cmd_read_rx);
     spi_wait_for_ready(SPI);
 
-    while(dma_intr_flag == 0) {
-        wait_for_interrupt();
-    }
+    dma_queue_wait(&desc);
 }
 
 int main(int argc, char *argv[])
@@ -123,18 +107,12 @@ int main(int argc, char *argv[])
     uint32_t core_clk = soc_ctrl_get_frequency(&soc_ctrl);
 
     CSR_SET_BITS(CSR_REG_MSTATUS, 0x8);
-    uint32_t mask = 1 << 19;
-    CSR_SET_BITS(CSR_REG_MIE, mask);
-    dma_intr_flag = 0;
-    CSR_SET_BITS(CSR_REG_MIE, mask);
+    dma_queue_init();
 
     spi_host_flash.base_addr = mmio_region_from_addr((uintptr_t)SPI_HOST_START_ADDRESS);
     spi_set_enable(&spi_host_flash, true);
     spi_output_enable(&spi_host_flash, true);
 
-    dma_t dma;
-    dma.base_addr = mmio_region_from_addr((uintptr_t)DMA_START_ADDRESS);
-
     uint16_t clk_div = 0;
     if (FLASH_CLK_MAX_HZ < core_clk / 2)
     {
@@ -181,7 +159,7 @@ int main(int argc, char *argv[])
         results[i] = 0;
     }
 
-    read_from_flash(&spi_host_flash, &dma, results, 4 * 32, FLASH_ADDR);
+    read_from_flash(&spi_host_flash, results, 4 * 32, FLASH_ADDR);
 
     for(uint32_t i = 0; i < 32; i++){
         printf("%d: 0x%08X\n\r", i, (unsigned int)results[i]);
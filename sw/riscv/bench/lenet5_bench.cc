@@ -0,0 +1,304 @@
+// Copyright EPFL contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+// Host-side benchmark of the lenet5 inference path of tflite_scpi. It links
+// the application's lenet5_test.cc against a host build of TFLM, runs the
+// built-in example (models/lenet5_input.h) and a corpus of inputs, and
+// reports latency percentiles, the arena high-water mark and the time spent
+// per op.
+//
+// Every inference of the built-in example must reproduce kGoldenScores and
+// every corpus input must give the same scores on each pass; any deviation
+// fails the run, so optimizations cannot silently change results.
+//
+// Usage: lenet5_bench [-n iterations] [--check-only] [input.bin ...]
+// where each input.bin holds one raw int8 32x32 image. Without inputs, the
+// corpus is the example shifted by a few pixels in each direction.
+//
+// Build and run from sw/riscv with
+// `make bench/lenet5_bench HOST_TFLM_DIR=<tflite-micro tree>`.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "lenet5_test.h"
+#include "models/lenet5_input.h"
+#include "tensorflow/lite/micro/micro_profiler_interface.h"
+
+namespace {
+
+constexpr int kDefaultIterations = 1000;
+constexpr int kMaxOpEvents = 64;
+constexpr int kShiftPixels = 2;
+constexpr int kImageSide = 32;
+
+const int8_t kGoldenScores[] = {-128, -128, 116, -126, -128,
+                                -128, -128, -128, -118, -128};
+constexpr size_t kNumScores = sizeof(kGoldenScores) / sizeof(kGoldenScores[0]);
+
+using Clock = std::chrono::steady_clock;
+
+// Accumulates wall time per op tag across invocations. Events do not nest in
+// MicroInterpreter, so a small stack of open events is enough.
+class OpTimer : public tflite::MicroProfilerInterface {
+ public:
+  uint32_t BeginEvent(const char* tag) override {
+    if (num_open_ == kMaxOpEvents) {
+      return kMaxOpEvents;
+    }
+    open_[num_open_] = {tag, Clock::now()};
+    return num_open_++;
+  }
+
+  void EndEvent(uint32_t event_handle) override {
+    if (event_handle >= num_open_) {
+      return;
+    }
+    const Event& event = open_[event_handle];
+    OpTotal& total = totals_[event.tag];
+    total.ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    Clock::now() - event.start)
+                    .count();
+    ++total.calls;
+    num_open_ = event_handle;
+  }
+
+  void Reset() { totals_.clear(); }
+
+  void Report(int inferences) const {
+    int64_t all_ns = 0;
+    for (const auto& entry : totals_) {
+      all_ns += entry.second.ns;
+    }
+    std::vector<std::pair<std::string, OpTotal>> ops(totals_.begin(),
+                                                     totals_.end());
+    std::sort(ops.begin(), ops.end(), [](const auto& a, const auto& b) {
+      return a.second.ns > b.second.ns;
+    });
+    printf("%-20s %8s %14s %8s\n", "op", "calls", "us/inference", "share");
+    for (const auto& op : ops) {
+      printf("%-20s %8d %14.2f %7.1f%%\n", op.first.c_str(),
+             op.second.calls / inferences,
+             op.second.ns / 1e3 / inferences,
+             all_ns > 0 ? 100.0 * op.second.ns / all_ns : 0.0);
+    }
+  }
+
+ private:
+  struct Event {
+    const char* tag;
+    Clock::time_point start;
+  };
+  struct OpTotal {
+    int64_t ns = 0;
+    int calls = 0;
+  };
+
+  Event open_[kMaxOpEvents];
+  uint32_t num_open_ = 0;
+  std::map<std::string, OpTotal> totals_;
+};
+
+struct Input {
+  std::string name;
+  std::vector<int8_t> data;
+  std::vector<int8_t> scores;  // From the first pass, or the golden vector
+};
+
+int failures = 0;
+
+void PrintScores(const int8_t* scores, size_t len) {
+  for (size_t i = 0; i < len; ++i) {
+    printf("%s%d", i == 0 ? "" : ",", scores[i]);
+  }
+  printf("\n");
+}
+
+bool LoadInput(const char* path, Input* input) {
+  FILE* file = fopen(path, "rb");
+  if (file == nullptr) {
+    perror(path);
+    return false;
+  }
+  input->name = path;
+  input->data.resize(lenet_input_data_size);
+  size_t read = fread(input->data.data(), 1, input->data.size(), file);
+  bool extra = fgetc(file) != EOF;
+  fclose(file);
+  if (read != input->data.size() || extra) {
+    printf("%s: expected %d bytes\n", path, lenet_input_data_size);
+    return false;
+  }
+  return true;
+}
+
+// The example image moved by (dx, dy), uncovered pixels set to background
+Input ShiftedExample(int dx, int dy) {
+  Input input;
+  input.name = "example" + std::string(dx < 0 ? "-" : "+") +
+               std::to_string(std::abs(dx)) + (dy < 0 ? "-" : "+") +
+               std::to_string(std::abs(dy));
+  input.data.assign(lenet_input_data_size, lenet_input_data[0]);
+  for (int y = 0; y < kImageSide; ++y) {
+    for (int x = 0; x < kImageSide; ++x) {
+      int sx = x - dx;
+      int sy = y - dy;
+      if (sx >= 0 && sx < kImageSide && sy >= 0 && sy < kImageSide) {
+        input.data[y * kImageSide + x] = lenet_input_data[sy * kImageSide + sx];
+      }
+    }
+  }
+  return input;
+}
+
+// Runs one inference and checks its scores; returns the latency in ns
+int64_t RunOne(Input* input) {
+  int8_t* out = nullptr;
+  size_t out_len = 0;
+  Clock::time_point start = Clock::now();
+  int status = infer(reinterpret_cast<const char*>(input->data.data()),
+                     input->data.size(), &out, &out_len);
+  int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   Clock::now() - start)
+                   .count();
+  if (status != 0) {
+    printf("FAIL %s: infer returned %d\n", input->name.c_str(), status);
+    ++failures;
+    return ns;
+  }
+  if (input->scores.empty()) {
+    input->scores.assign(out, out + out_len);
+  } else if (out_len != input->scores.size() ||
+             memcmp(out, input->scores.data(), out_len) != 0) {
+    printf("FAIL %s: expected ", input->name.c_str());
+    PrintScores(input->scores.data(), input->scores.size());
+    printf("     got ");
+    PrintScores(out, out_len);
+    ++failures;
+  }
+  return ns;
+}
+
+double Percentile(const std::vector<int64_t>& sorted, double p) {
+  size_t index = static_cast<size_t>(p / 100.0 * (sorted.size() - 1) + 0.5);
+  return sorted[index] / 1e3;
+}
+
+void ReportLatency(std::vector<int64_t> ns) {
+  std::sort(ns.begin(), ns.end());
+  double sum = 0;
+  for (int64_t v : ns) {
+    sum += v;
+  }
+  printf("%-8s %10s %10s %10s %10s %10s %10s\n", "runs", "min us", "mean us",
+         "p50 us", "p90 us", "p99 us", "max us");
+  printf("%-8zu %10.2f %10.2f %10.2f %10.2f %10.2f %10.2f\n", ns.size(),
+         ns.front() / 1e3, sum / ns.size() / 1e3, Percentile(ns, 50),
+         Percentile(ns, 90), Percentile(ns, 99), ns.back() / 1e3);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int iterations = kDefaultIterations;
+  bool check_only = false;
+  std::vector<Input> inputs(1);
+  inputs[0].name = "example";
+  inputs[0].data.assign(lenet_input_data,
+                        lenet_input_data + lenet_input_data_size);
+  inputs[0].scores.assign(kGoldenScores, kGoldenScores + kNumScores);
+
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+      iterations = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--check-only") == 0) {
+      check_only = true;
+    } else {
+      inputs.emplace_back();
+      if (!LoadInput(argv[i], &inputs.back())) {
+        return EXIT_FAILURE;
+      }
+    }
+  }
+  if (iterations < 1) {
+    printf("usage: %s [-n iterations] [--check-only] [input.bin ...]\n",
+           argv[0]);
+    return EXIT_FAILURE;
+  }
+  if (inputs.size() == 1) {
+    for (int dy = -kShiftPixels; dy <= kShiftPixels; dy += kShiftPixels) {
+      for (int dx = -kShiftPixels; dx <= kShiftPixels; dx += kShiftPixels) {
+        if (dx != 0 || dy != 0) {
+          inputs.push_back(ShiftedExample(dx, dy));
+        }
+      }
+    }
+  }
+
+  if (init_tflite() != 0) {
+    printf("init_tflite failed\n");
+    return EXIT_FAILURE;
+  }
+  size_t arena_size = 0;
+  size_t arena_used = tflite_arena_used(&arena_size);
+
+  // Correctness pass: the example against the golden scores, the corpus
+  // recorded for the determinism check of the timed passes
+  for (Input& input : inputs) {
+    RunOne(&input);
+  }
+  if (failures != 0) {
+    printf("%d check(s) failed\n", failures);
+    return EXIT_FAILURE;
+  }
+  printf("lenet5 example matches the golden scores\n");
+  if (check_only) {
+    return EXIT_SUCCESS;
+  }
+
+  // Latency, without a profiler attached
+  std::vector<int64_t> example_ns;
+  std::vector<int64_t> corpus_ns;
+  example_ns.reserve(iterations);
+  corpus_ns.reserve(static_cast<size_t>(iterations) * (inputs.size() - 1));
+  for (int i = 0; i < iterations; ++i) {
+    for (size_t j = 0; j < inputs.size(); ++j) {
+      int64_t ns = RunOne(&inputs[j]);
+      (j == 0 ? example_ns : corpus_ns).push_back(ns);
+    }
+  }
+
+  // Per-op time, on a separate pass since profiling adds overhead
+  OpTimer op_timer;
+  if (tflite_set_profiler(&op_timer) != 0) {
+    printf("tflite_set_profiler failed\n");
+    return EXIT_FAILURE;
+  }
+  for (int i = 0; i < iterations; ++i) {
+    RunOne(&inputs[0]);
+  }
+  tflite_set_profiler(nullptr);
+
+  if (failures != 0) {
+    printf("%d check(s) failed\n", failures);
+    return EXIT_FAILURE;
+  }
+
+  printf("\nexample\n");
+  ReportLatency(example_ns);
+  if (!corpus_ns.empty()) {
+    printf("\ncorpus (%zu inputs)\n", inputs.size() - 1);
+    ReportLatency(corpus_ns);
+  }
+  printf("\narena: %zu of %zu bytes used\n\n", arena_used, arena_size);
+  op_timer.Report(iterations);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,248 @@
+// Copyright EPFL contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+// Host-side correctness and throughput check for the lib/base mem*
+// implementations. The device versions are pulled in under a `base_` prefix
+// and compared against the byte-at-a-time loops they replaced, over a range
+// of sizes and source/destination misalignments.
+//
+// Build and run from sw/riscv with `make bench/memory_bench`.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define memcpy base_memcpy
+#define memset base_memset
+#define memcmp base_memcmp
+#define memchr base_memchr
+#define memrchr base_memrchr
+#include "memory.c"
+#undef memcpy
+#undef memset
+#undef memcmp
+#undef memchr
+#undef memrchr
+
+#define BENCH_BUFFER_SIZE 8192
+#define BENCH_GUARD 16
+#define BENCH_BYTES_PER_POINT (16u * 1024u * 1024u)
+
+// Reference byte-loop versions, as they were before the word-wise rewrite.
+// The `noinline` keeps the benchmark honest about call overhead.
+__attribute__((noinline, optimize("no-tree-loop-distribute-patterns")))
+static void *byte_memcpy(void *dest, const void *src, size_t len) {
+  uint8_t *dest8 = (uint8_t *)dest;
+  const uint8_t *src8 = (const uint8_t *)src;
+  for (size_t i = 0; i < len; ++i) {
+    dest8[i] = src8[i];
+  }
+  return dest;
+}
+
+__attribute__((noinline, optimize("no-tree-loop-distribute-patterns")))
+static void *byte_memset(void *dest, int value, size_t len) {
+  uint8_t *dest8 = (uint8_t *)dest;
+  for (size_t i = 0; i < len; ++i) {
+    dest8[i] = (uint8_t)value;
+  }
+  return dest;
+}
+
+__attribute__((noinline))
+static int byte_memcmp(const void *lhs, const void *rhs, size_t len) {
+  const uint8_t *lhs8 = (const uint8_t *)lhs;
+  const uint8_t *rhs8 = (const uint8_t *)rhs;
+  for (size_t i = 0; i < len; ++i) {
+    if (lhs8[i] < rhs8[i]) {
+      return kMemCmpLt;
+    } else if (lhs8[i] > rhs8[i]) {
+      return kMemCmpGt;
+    }
+  }
+  return kMemCmpEq;
+}
+
+__attribute__((noinline))
+static void *byte_memchr(const void *ptr, int value, size_t len) {
+  uint8_t *ptr8 = (uint8_t *)ptr;
+  for (size_t i = 0; i < len; ++i) {
+    if (ptr8[i] == (uint8_t)value) {
+      return ptr8 + i;
+    }
+  }
+  return NULL;
+}
+
+static const size_t kSizes[] = {0, 1, 2, 3, 4, 5, 7, 8, 15, 16, 17, 31, 32,
+                                33, 63, 64, 100, 255, 256, 1024, 1027, 4096};
+static const size_t kNumSizes = sizeof(kSizes) / sizeof(kSizes[0]);
+
+static _Alignas(16) uint8_t src_buf[BENCH_BUFFER_SIZE + 2 * BENCH_GUARD];
+static _Alignas(16) uint8_t dst_buf[BENCH_BUFFER_SIZE + 2 * BENCH_GUARD];
+static _Alignas(16) uint8_t ref_buf[BENCH_BUFFER_SIZE + 2 * BENCH_GUARD];
+
+static int failures = 0;
+
+static void fail(const char *what, size_t len, size_t dst_off,
+                 size_t src_off) {
+  printf("FAIL %s len=%zu dst_off=%zu src_off=%zu\n", what, len, dst_off,
+         src_off);
+  ++failures;
+}
+
+static void fill_pattern(uint8_t *buf, size_t len, uint32_t seed) {
+  for (size_t i = 0; i < len; ++i) {
+    seed = seed * 1103515245u + 12345u;
+    buf[i] = (uint8_t)(seed >> 16);
+  }
+}
+
+static void check_memcpy(size_t len, size_t dst_off, size_t src_off) {
+  fill_pattern(src_buf, sizeof(src_buf), (uint32_t)(len + src_off));
+  fill_pattern(dst_buf, sizeof(dst_buf), 7);
+  memcpy(ref_buf, dst_buf, sizeof(dst_buf));
+  byte_memcpy(ref_buf + BENCH_GUARD + dst_off, src_buf + BENCH_GUARD + src_off,
+              len);
+  void *ret = base_memcpy(dst_buf + BENCH_GUARD + dst_off,
+                          src_buf + BENCH_GUARD + src_off, len);
+  if (ret != dst_buf + BENCH_GUARD + dst_off ||
+      memcmp(ref_buf, dst_buf, sizeof(dst_buf)) != 0) {
+    fail("memcpy", len, dst_off, src_off);
+  }
+}
+
+static void check_memset(size_t len, size_t dst_off) {
+  fill_pattern(dst_buf, sizeof(dst_buf), 11);
+  memcpy(ref_buf, dst_buf, sizeof(dst_buf));
+  byte_memset(ref_buf + BENCH_GUARD + dst_off, 0xa5, len);
+  void *ret = base_memset(dst_buf + BENCH_GUARD + dst_off, 0x1a5, len);
+  if (ret != dst_buf + BENCH_GUARD + dst_off ||
+      memcmp(ref_buf, dst_buf, sizeof(dst_buf)) != 0) {
+    fail("memset", len, dst_off, 0);
+  }
+}
+
+static void check_memcmp(size_t len, size_t lhs_off, size_t rhs_off) {
+  uint8_t *lhs = src_buf + BENCH_GUARD + lhs_off;
+  uint8_t *rhs = dst_buf + BENCH_GUARD + rhs_off;
+  fill_pattern(lhs, len, 3);
+  memcpy(rhs, lhs, len);
+  if (base_memcmp(lhs, rhs, len) != byte_memcmp(lhs, rhs, len)) {
+    fail("memcmp/equal", len, lhs_off, rhs_off);
+  }
+  // Flip every position in turn, both upwards and downwards.
+  for (size_t i = 0; i < len; ++i) {
+    uint8_t saved = rhs[i];
+    rhs[i] = (uint8_t)(saved + 1);
+    if (base_memcmp(lhs, rhs, len) != byte_memcmp(lhs, rhs, len)) {
+      fail("memcmp/greater", len, lhs_off, rhs_off);
+    }
+    rhs[i] = (uint8_t)(saved - 1);
+    if (base_memcmp(lhs, rhs, len) != byte_memcmp(lhs, rhs, len)) {
+      fail("memcmp/less", len, lhs_off, rhs_off);
+    }
+    rhs[i] = saved;
+  }
+}
+
+static void check_memchr(size_t len, size_t off) {
+  uint8_t *buf = src_buf + BENCH_GUARD + off;
+  base_memset(buf, 0x80, len);
+  if (base_memchr(buf, 0x00, len) != NULL) {
+    fail("memchr/absent", len, off, 0);
+  }
+  for (size_t i = 0; i < len; ++i) {
+    buf[i] = 0x01;
+    if (base_memchr(buf, 0x101, len) != byte_memchr(buf, 0x01, len)) {
+      fail("memchr/present", len, off, 0);
+    }
+    // Bytes that differ from the target only in the high bit must not be
+    // mistaken for a match by the word-wise zero-byte test.
+    buf[i] = 0x81;
+    if (base_memchr(buf, 0x01, len) != NULL) {
+      fail("memchr/highbit", len, off, 0);
+    }
+    buf[i] = 0x80;
+  }
+}
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+typedef void *(*copy_fn_t)(void *, const void *, size_t);
+
+static double copy_throughput(copy_fn_t fn, size_t len, size_t dst_off,
+                              size_t src_off) {
+  size_t iterations = BENCH_BYTES_PER_POINT / len;
+  double start = now_seconds();
+  for (size_t i = 0; i < iterations; ++i) {
+    fn(dst_buf + BENCH_GUARD + dst_off, src_buf + BENCH_GUARD + src_off, len);
+    __asm__ volatile("" ::: "memory");
+  }
+  double elapsed = now_seconds() - start;
+  return (double)(iterations * len) / elapsed / 1e6;
+}
+
+static void *base_memset_as_copy(void *dest, const void *src, size_t len) {
+  return base_memset(dest, *(const uint8_t *)src, len);
+}
+
+static void *byte_memset_as_copy(void *dest, const void *src, size_t len) {
+  return byte_memset(dest, *(const uint8_t *)src, len);
+}
+
+static void report_throughput(void) {
+  static const size_t kBenchSizes[] = {16, 64, 256, 1024, 4096};
+  static const size_t kBenchOffsets[][2] = {{0, 0}, {1, 1}, {0, 1}, {3, 2}};
+
+  printf("%-8s %6s %8s %12s %12s %8s\n", "func", "len", "dst/src", "byte MB/s",
+         "word MB/s", "speedup");
+  for (size_t s = 0; s < sizeof(kBenchSizes) / sizeof(kBenchSizes[0]); ++s) {
+    for (size_t o = 0; o < sizeof(kBenchOffsets) / sizeof(kBenchOffsets[0]);
+         ++o) {
+      size_t len = kBenchSizes[s];
+      size_t dst_off = kBenchOffsets[o][0];
+      size_t src_off = kBenchOffsets[o][1];
+      double ref = copy_throughput(byte_memcpy, len, dst_off, src_off);
+      double opt = copy_throughput(base_memcpy, len, dst_off, src_off);
+      printf("%-8s %6zu %5zu/%zu %12.1f %12.1f %7.2fx\n", "memcpy", len,
+             dst_off, src_off, ref, opt, opt / ref);
+    }
+    size_t len = kBenchSizes[s];
+    double ref = copy_throughput(byte_memset_as_copy, len, 1, 0);
+    double opt = copy_throughput(base_memset_as_copy, len, 1, 0);
+    printf("%-8s %6zu %5d/%d %12.1f %12.1f %7.2fx\n", "memset", len, 1, 0, ref,
+           opt, opt / ref);
+  }
+}
+
+int main(int argc, char **argv) {
+  for (size_t s = 0; s < kNumSizes; ++s) {
+    for (size_t dst_off = 0; dst_off < 4; ++dst_off) {
+      check_memset(kSizes[s], dst_off);
+      check_memchr(kSizes[s], dst_off);
+      for (size_t src_off = 0; src_off < 4; ++src_off) {
+        check_memcpy(kSizes[s], dst_off, src_off);
+        check_memcmp(kSizes[s], dst_off, src_off);
+      }
+    }
+  }
+  if (failures != 0) {
+    printf("%d check(s) failed\n", failures);
+    return EXIT_FAILURE;
+  }
+  printf("All mem* checks passed\n");
+
+  if (argc > 1 && strcmp(argv[1], "--check-only") == 0) {
+    return EXIT_SUCCESS;
+  }
+  report_throughput();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,325 @@
+// Copyright EPFL contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+// Host-side bit-exactness and throughput check of the int8 Conv2D and
+// FullyConnected kernels of tflite_scpi (apps/tflite_scpi/xheep_nn.c)
+// against the TFLM reference_integer_ops kernels they replace. Shapes,
+// strides, dilations, paddings, offsets and requantization parameters are
+// drawn at random, plus the LeNet5 layers; every output byte must match.
+//
+// Build and run from sw/riscv with
+// `make bench/xheep_nn_bench HOST_TFLM_DIR=<tflite-micro tree>`; only the
+// reference kernel headers are used, not libtflm.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "tensorflow/lite/kernels/internal/reference/integer_ops/conv.h"
+#include "tensorflow/lite/kernels/internal/reference/integer_ops/fully_connected.h"
+#include "tensorflow/lite/kernels/internal/types.h"
+#include "xheep_nn.h"
+
+namespace {
+
+constexpr int kRandomCases = 2000;
+constexpr double kBenchSeconds = 0.5;
+
+uint32_t seed = 1;
+int failures = 0;
+
+int Random(int lo, int hi) {
+  seed = seed * 1103515245u + 12345u;
+  return lo + static_cast<int>((seed >> 8) % static_cast<uint32_t>(hi - lo + 1));
+}
+
+void Fill(std::vector<int8_t>* v) {
+  for (int8_t& x : *v) {
+    x = static_cast<int8_t>(Random(-128, 127));
+  }
+}
+
+struct ConvCase {
+  int batches, ih, iw, ic, fh, fw, oc;
+  int stride_h, stride_w, dilation_h, dilation_w, pad_h, pad_w;
+  int32_t input_offset, output_offset, act_min, act_max;
+  bool bias;
+};
+
+struct FcCase {
+  int batches, accum_depth, output_depth;
+  int32_t input_offset, filter_offset, output_offset, act_min, act_max;
+  bool bias;
+};
+
+// Multipliers as produced by QuantizeMultiplier: [2^30, 2^31) and a shift
+// that brings int32 accumulators back to the int8 range
+void RandomMultiplier(int32_t* multiplier, int32_t* shift) {
+  *multiplier = (1 << 30) + Random(0, (1 << 30) - 1);
+  *shift = Random(-14, 1);
+}
+
+double Seconds() {
+  return std::chrono::duration<double>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+template <typename F>
+double RunsPerSecond(F&& fn) {
+  int runs = 0;
+  double start = Seconds();
+  double elapsed;
+  do {
+    fn();
+    ++runs;
+    elapsed = Seconds() - start;
+  } while (elapsed < kBenchSeconds);
+  return runs / elapsed;
+}
+
+// Returns the speedup over the reference when `bench` is set
+double CheckConv(const ConvCase& c, const char* name, bool bench) {
+  const int oh = (c.ih + 2 * c.pad_h - c.dilation_h * (c.fh - 1) - 1) / c.stride_h + 1;
+  const int ow = (c.iw + 2 * c.pad_w - c.dilation_w * (c.fw - 1) - 1) / c.stride_w + 1;
+  if (oh < 1 || ow < 1) {
+    return 0;
+  }
+  std::vector<int8_t> input(c.batches * c.ih * c.iw * c.ic);
+  std::vector<int8_t> filter(c.oc * c.fh * c.fw * c.ic);
+  std::vector<int32_t> bias(c.oc);
+  std::vector<int32_t> multiplier(c.oc);
+  std::vector<int32_t> shift(c.oc);
+  std::vector<int8_t> expected(c.batches * oh * ow * c.oc);
+  std::vector<int8_t> actual(expected.size());
+  Fill(&input);
+  Fill(&filter);
+  for (int i = 0; i < c.oc; ++i) {
+    bias[i] = Random(-20000, 20000);
+    RandomMultiplier(&multiplier[i], &shift[i]);
+  }
+
+  tflite::ConvParams params = {};
+  params.padding_values.height = c.pad_h;
+  params.padding_values.width = c.pad_w;
+  params.stride_height = c.stride_h;
+  params.stride_width = c.stride_w;
+  params.dilation_height_factor = c.dilation_h;
+  params.dilation_width_factor = c.dilation_w;
+  params.input_offset = c.input_offset;
+  params.output_offset = c.output_offset;
+  params.quantized_activation_min = c.act_min;
+  params.quantized_activation_max = c.act_max;
+  const tflite::RuntimeShape input_shape({c.batches, c.ih, c.iw, c.ic});
+  const tflite::RuntimeShape filter_shape({c.oc, c.fh, c.fw, c.ic});
+  const tflite::RuntimeShape bias_shape({c.oc});
+  const tflite::RuntimeShape output_shape({c.batches, oh, ow, c.oc});
+  const int32_t* bias_data = c.bias ? bias.data() : nullptr;
+
+  auto reference = [&]() {
+    tflite::reference_integer_ops::ConvPerChannel(
+        params, multiplier.data(), shift.data(), input_shape, input.data(),
+        filter_shape, filter.data(), bias_shape, bias_data, output_shape,
+        expected.data());
+  };
+  xheep_conv_s8_params_t p = {};
+  p.batches = c.batches;
+  p.input_h = c.ih;
+  p.input_w = c.iw;
+  p.input_c = c.ic;
+  p.filter_h = c.fh;
+  p.filter_w = c.fw;
+  p.output_h = oh;
+  p.output_w = ow;
+  p.output_c = c.oc;
+  p.stride_h = c.stride_h;
+  p.stride_w = c.stride_w;
+  p.dilation_h = c.dilation_h;
+  p.dilation_w = c.dilation_w;
+  p.pad_h = c.pad_h;
+  p.pad_w = c.pad_w;
+  p.input_offset = c.input_offset;
+  p.output_offset = c.output_offset;
+  p.act_min = c.act_min;
+  p.act_max = c.act_max;
+  p.multiplier = multiplier.data();
+  p.shift = shift.data();
+  auto optimized = [&]() {
+    xheep_conv_s8(&p, input.data(), filter.data(), bias_data, actual.data());
+  };
+
+  reference();
+  optimized();
+  if (memcmp(expected.data(), actual.data(), expected.size()) != 0) {
+    printf("FAIL conv %s: in %dx%dx%dx%d filter %dx%dx%d stride %d,%d "
+           "dilation %d,%d pad %d,%d offsets %d,%d\n",
+           name, c.batches, c.ih, c.iw, c.ic, c.oc, c.fh, c.fw, c.stride_h,
+           c.stride_w, c.dilation_h, c.dilation_w, c.pad_h, c.pad_w,
+           c.input_offset, c.output_offset);
+    ++failures;
+    return 0;
+  }
+  if (!bench) {
+    return 0;
+  }
+  return RunsPerSecond(optimized) / RunsPerSecond(reference);
+}
+
+double CheckFc(const FcCase& c, const char* name, bool bench) {
+  std::vector<int8_t> input(c.batches * c.accum_depth);
+  std::vector<int8_t> filter(c.output_depth * c.accum_depth);
+  std::vector<int32_t> bias(c.output_depth);
+  std::vector<int8_t> expected(c.batches * c.output_depth);
+  std::vector<int8_t> actual(expected.size());
+  int32_t multiplier;
+  int32_t shift;
+  Fill(&input);
+  Fill(&filter);
+  for (int32_t& b : bias) {
+    b = Random(-20000, 20000);
+  }
+  RandomMultiplier(&multiplier, &shift);
+
+  tflite::FullyConnectedParams params = {};
+  params.input_offset = c.input_offset;
+  params.weights_offset = c.filter_offset;
+  params.output_offset = c.output_offset;
+  params.output_multiplier = multiplier;
+  params.output_shift = shift;
+  params.quantized_activation_min = c.act_min;
+  params.quantized_activation_max = c.act_max;
+  const tflite::RuntimeShape input_shape({c.batches, c.accum_depth});
+  const tflite::RuntimeShape filter_shape({c.output_depth, c.accum_depth});
+  const tflite::RuntimeShape bias_shape({c.output_depth});
+  const tflite::RuntimeShape output_shape({c.batches, c.output_depth});
+  const int32_t* bias_data = c.bias ? bias.data() : nullptr;
+
+  auto reference = [&]() {
+    tflite::reference_integer_ops::FullyConnected(
+        params, input_shape, input.data(), filter_shape, filter.data(),
+        bias_shape, bias_data, output_shape, expected.data());
+  };
+  xheep_fc_s8_params_t p = {};
+  p.batches = c.batches;
+  p.accum_depth = c.accum_depth;
+  p.output_depth = c.output_depth;
+  p.input_offset = c.input_offset;
+  p.filter_offset = c.filter_offset;
+  p.output_offset = c.output_offset;
+  p.multiplier = multiplier;
+  p.shift = shift;
+  p.act_min = c.act_min;
+  p.act_max = c.act_max;
+  auto optimized = [&]() {
+    xheep_fully_connected_s8(&p, input.data(), filter.data(), bias_data,
+                             actual.data());
+  };
+
+  reference();
+  optimized();
+  if (memcmp(expected.data(), actual.data(), expected.size()) != 0) {
+    printf("FAIL fc %s: %dx%d -> %d offsets %d,%d,%d\n", name, c.batches,
+           c.accum_depth, c.output_depth, c.input_offset, c.filter_offset,
+           c.output_offset);
+    ++failures;
+    return 0;
+  }
+  if (!bench) {
+    return 0;
+  }
+  return RunsPerSecond(optimized) / RunsPerSecond(reference);
+}
+
+ConvCase RandomConv() {
+  ConvCase c;
+  c.batches = Random(1, 2);
+  c.ih = Random(1, 12);
+  c.iw = Random(1, 12);
+  c.ic = Random(1, 9);
+  c.fh = Random(1, 5);
+  c.fw = Random(1, 5);
+  c.oc = Random(1, 6);
+  c.stride_h = Random(1, 3);
+  c.stride_w = Random(1, 3);
+  c.dilation_h = Random(1, 2);
+  c.dilation_w = Random(1, 2);
+  c.pad_h = Random(0, c.fh / 2 + 1);
+  c.pad_w = Random(0, c.fw / 2 + 1);
+  c.input_offset = Random(-127, 128);
+  c.output_offset = Random(-128, 127);
+  c.act_min = Random(-128, 0);
+  c.act_max = Random(0, 127);
+  c.bias = Random(0, 3) != 0;
+  return c;
+}
+
+FcCase RandomFc() {
+  FcCase c;
+  c.batches = Random(1, 3);
+  c.accum_depth = Random(1, 300);
+  c.output_depth = Random(1, 40);
+  c.input_offset = Random(-127, 128);
+  c.filter_offset = Random(0, 3) == 0 ? Random(-127, 128) : 0;
+  c.output_offset = Random(-128, 127);
+  c.act_min = Random(-128, 0);
+  c.act_max = Random(0, 127);
+  c.bias = Random(0, 3) != 0;
+  return c;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool check_only = argc > 1 && strcmp(argv[1], "--check-only") == 0;
+
+  for (int i = 0; i < kRandomCases; ++i) {
+    CheckConv(RandomConv(), "random", false);
+    CheckFc(RandomFc(), "random", false);
+  }
+
+  // The LeNet5 layers: 32x32x1 -> conv 5x5x6 -> pool -> conv 5x5x16 -> pool
+  // -> fc 400/120/84/10, int8 inputs with a -128 zero point
+  const ConvCase kLenetConv[] = {
+      {1, 32, 32, 1, 5, 5, 6, 1, 1, 1, 1, 0, 0, 128, -128, -128, 127, true},
+      {1, 14, 14, 6, 5, 5, 16, 1, 1, 1, 1, 0, 0, 128, -128, -128, 127, true},
+  };
+  const FcCase kLenetFc[] = {
+      {1, 400, 120, 128, 0, -128, -128, 127, true},
+      {1, 120, 84, 128, 0, -128, -128, 127, true},
+      {1, 84, 10, 128, 0, -128, -128, 127, true},
+  };
+  const char* kConvNames[] = {"lenet_conv1", "lenet_conv2"};
+  const char* kFcNames[] = {"lenet_fc1", "lenet_fc2", "lenet_fc3"};
+  double conv_speedup[2] = {};
+  double fc_speedup[3] = {};
+  for (int i = 0; i < 2; ++i) {
+    conv_speedup[i] = CheckConv(kLenetConv[i], kConvNames[i], !check_only);
+  }
+  for (int i = 0; i < 3; ++i) {
+    fc_speedup[i] = CheckFc(kLenetFc[i], kFcNames[i], !check_only);
+  }
+
+  if (failures != 0) {
+    printf("%d check(s) failed\n", failures);
+    return EXIT_FAILURE;
+  }
+  printf("All xheep_nn checks passed\n");
+  if (check_only) {
+    return EXIT_SUCCESS;
+  }
+
+  // Host speedups only hint at the rv32imc ones, which come mostly from
+  // the packed loads and the hoisted input offset
+  printf("%-12s %8s\n", "layer", "speedup");
+  for (int i = 0; i < 2; ++i) {
+    printf("%-12s %7.2fx\n", kConvNames[i], conv_speedup[i]);
+  }
+  for (int i = 0; i < 3; ++i) {
+    printf("%-12s %7.2fx\n", kFcNames[i], fc_speedup[i]);
+  }
+  return EXIT_SUCCESS;
+}
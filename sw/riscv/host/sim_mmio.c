@@ -0,0 +1,98 @@
+// Copyright EPFL contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "sim_mmio.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "csr.h"
+#include "mmio.h"
+
+static sim_periph_t sim_periphs[SIM_MMIO_MAX_PERIPHS];
+static size_t sim_periph_count = 0;
+
+void sim_mmio_register(const sim_periph_t *periph) {
+  if (sim_periph_count == SIM_MMIO_MAX_PERIPHS) {
+    fprintf(stderr, "sim: too many peripherals, dropping %s\n", periph->name);
+    abort();
+  }
+  sim_periphs[sim_periph_count++] = *periph;
+}
+
+static const sim_periph_t *sim_mmio_find(uintptr_t address) {
+  for (size_t i = 0; i < sim_periph_count; ++i) {
+    if (address >= sim_periphs[i].base &&
+        address - sim_periphs[i].base < sim_periphs[i].size) {
+      return &sim_periphs[i];
+    }
+  }
+  fprintf(stderr, "sim: access to unmapped address 0x%08lx\n",
+          (unsigned long)address);
+  abort();
+}
+
+mmio_region_t mmio_region_from_addr(uintptr_t address) {
+  return (mmio_region_t){.mock = (void *)address};
+}
+
+uint32_t mmio_region_read32(mmio_region_t base, ptrdiff_t offset) {
+  uintptr_t address = (uintptr_t)base.mock + offset;
+  const sim_periph_t *periph = sim_mmio_find(address);
+  return periph->read32(periph->ctx, address - periph->base);
+}
+
+void mmio_region_write32(mmio_region_t base, ptrdiff_t offset, uint32_t value) {
+  uintptr_t address = (uintptr_t)base.mock + offset;
+  const sim_periph_t *periph = sim_mmio_find(address);
+  periph->write32(periph->ctx, address - periph->base, value);
+}
+
+uint8_t mmio_region_read8(mmio_region_t base, ptrdiff_t offset) {
+  uint32_t word = mmio_region_read32(base, offset & ~3);
+  return (uint8_t)(word >> (8 * (offset & 3)));
+}
+
+void mmio_region_write8(mmio_region_t base, ptrdiff_t offset, uint8_t value) {
+  uint32_t shift = 8 * (offset & 3);
+  uint32_t word = mmio_region_read32(base, offset & ~3);
+  word = (word & ~(0xffu << shift)) | ((uint32_t)value << shift);
+  mmio_region_write32(base, offset & ~3, word);
+}
+
+// CSRs are plain storage, except for the counters which follow the host clock
+static uint32_t sim_csrs[4096];
+
+static uint64_t sim_cycles(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * SIM_CYCLE_FREQ_HZ +
+         (uint64_t)ts.tv_nsec * (SIM_CYCLE_FREQ_HZ / 1000000000u);
+}
+
+uint32_t mock_csr_read(uint32_t addr) {
+  switch (addr) {
+    case CSR_REG_MCYCLE:
+    case CSR_REG_MINSTRET:
+      return (uint32_t)sim_cycles();
+    case CSR_REG_MCYCLEH:
+    case CSR_REG_MINSTRETH:
+      return (uint32_t)(sim_cycles() >> 32);
+    default:
+      return sim_csrs[addr & 0xfff];
+  }
+}
+
+void mock_csr_write(uint32_t addr, uint32_t value) {
+  sim_csrs[addr & 0xfff] = value;
+}
+
+void mock_csr_set_bits(uint32_t addr, uint32_t mask) {
+  sim_csrs[addr & 0xfff] |= mask;
+}
+
+void mock_csr_clear_bits(uint32_t addr, uint32_t mask) {
+  sim_csrs[addr & 0xfff] &= ~mask;
+}
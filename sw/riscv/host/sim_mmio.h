@@ -0,0 +1,46 @@
+// Copyright EPFL contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef _HOST_SIM_MMIO_H_
+#define _HOST_SIM_MMIO_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Host implementation of the `-DMOCK_MMIO` and `-DMOCK_CSR` hooks of
+ * base/mmio.h and base/csr.h. Every MMIO access is routed to the simulated
+ * peripheral whose address range contains it; an access outside all of them
+ * aborts with the offending address.
+ */
+
+/**
+ * A simulated peripheral, covering [base, base + size).
+ */
+typedef struct sim_periph {
+  const char *name;
+  uintptr_t base;
+  size_t size;
+  uint32_t (*read32)(void *ctx, ptrdiff_t offset);
+  void (*write32)(void *ctx, ptrdiff_t offset, uint32_t value);
+  void *ctx;
+} sim_periph_t;
+
+/**
+ * Maximum number of peripherals that can be registered.
+ */
+#define SIM_MMIO_MAX_PERIPHS 16
+
+/**
+ * Make `periph` (copied) answer accesses to its address range.
+ */
+void sim_mmio_register(const sim_periph_t *periph);
+
+/**
+ * Frequency at which the simulated mcycle counts, derived from the host
+ * monotonic clock.
+ */
+#define SIM_CYCLE_FREQ_HZ 1000000000u
+
+#endif  // _HOST_SIM_MMIO_H_
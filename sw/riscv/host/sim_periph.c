@@ -0,0 +1,192 @@
+// Copyright EPFL contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "sim_periph.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "core_v_mini_mcu.h"
+#include "sim_mmio.h"
+#include "soc_ctrl_regs.h"
+#include "uart_regs.h"
+
+/**
+ * UART
+ */
+
+// Empty polls after which RXEMPTY is only reported after sleeping, so a
+// firmware spinning on STATUS does not burn a host core
+#define SIM_UART_BUSY_POLLS 1024
+#define SIM_UART_IDLE_POLL_MS 1
+
+typedef struct sim_uart {
+  int rx_fd;
+  int tx_fd;
+  uint32_t regs[UART_TIMEOUT_CTRL_REG_OFFSET / 4 + 1];
+  uint8_t tx_buf[4096];
+  size_t tx_len;
+  uint32_t empty_polls;
+} sim_uart_t;
+
+static sim_uart_t sim_uart;
+
+static void sim_uart_flush(sim_uart_t *u) {
+  size_t done = 0;
+  while (done < u->tx_len) {
+    ssize_t n = write(u->tx_fd, u->tx_buf + done, u->tx_len - done);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      // The reader went away, nobody is left to serve
+      exit(EXIT_SUCCESS);
+    }
+    done += (size_t)n;
+  }
+  u->tx_len = 0;
+}
+
+static int sim_uart_rx_ready(sim_uart_t *u) {
+  sim_uart_flush(u);
+  int timeout = u->empty_polls < SIM_UART_BUSY_POLLS ? 0 : SIM_UART_IDLE_POLL_MS;
+  struct pollfd pfd = {.fd = u->rx_fd, .events = POLLIN};
+  if (poll(&pfd, 1, timeout) > 0) {
+    u->empty_polls = 0;
+    return 1;
+  }
+  ++u->empty_polls;
+  return 0;
+}
+
+static uint32_t sim_uart_read32(void *ctx, ptrdiff_t offset) {
+  sim_uart_t *u = ctx;
+  switch (offset) {
+    case UART_STATUS_REG_OFFSET: {
+      uint32_t status = (1u << UART_STATUS_TXEMPTY_BIT) |
+                        (1u << UART_STATUS_TXIDLE_BIT);
+      if (!sim_uart_rx_ready(u)) {
+        status |= (1u << UART_STATUS_RXEMPTY_BIT) |
+                  (1u << UART_STATUS_RXIDLE_BIT);
+      }
+      return status;
+    }
+    case UART_RDATA_REG_OFFSET: {
+      uint8_t byte;
+      ssize_t n;
+      sim_uart_flush(u);
+      do {
+        n = read(u->rx_fd, &byte, 1);
+      } while (n < 0 && errno == EINTR);
+      if (n <= 0) {
+        // End of input: behave like the board being switched off
+        exit(EXIT_SUCCESS);
+      }
+      return byte;
+    }
+    default:
+      return u->regs[offset / 4 % (sizeof(u->regs) / sizeof(u->regs[0]))];
+  }
+}
+
+static void sim_uart_write32(void *ctx, ptrdiff_t offset, uint32_t value) {
+  sim_uart_t *u = ctx;
+  if (offset == UART_WDATA_REG_OFFSET) {
+    u->tx_buf[u->tx_len++] = (uint8_t)value;
+    if ((uint8_t)value == '\n' || u->tx_len == sizeof(u->tx_buf)) {
+      sim_uart_flush(u);
+    }
+    return;
+  }
+  u->regs[offset / 4 % (sizeof(u->regs) / sizeof(u->regs[0]))] = value;
+}
+
+void sim_uart_init(int rx_fd, int tx_fd) {
+  sim_uart.rx_fd = rx_fd;
+  sim_uart.tx_fd = tx_fd;
+  sim_mmio_register(&(sim_periph_t){
+      .name = "uart",
+      .base = UART_START_ADDRESS,
+      .size = UART_SIZE,
+      .read32 = sim_uart_read32,
+      .write32 = sim_uart_write32,
+      .ctx = &sim_uart,
+  });
+}
+
+/**
+ * Plain register files
+ */
+
+#define SIM_REGFILE_WORDS 64
+
+typedef struct sim_regfile {
+  uint32_t regs[SIM_REGFILE_WORDS];
+} sim_regfile_t;
+
+static uint32_t sim_regfile_read32(void *ctx, ptrdiff_t offset) {
+  sim_regfile_t *r = ctx;
+  return r->regs[offset / 4 % SIM_REGFILE_WORDS];
+}
+
+static void sim_regfile_write32(void *ctx, ptrdiff_t offset, uint32_t value) {
+  sim_regfile_t *r = ctx;
+  r->regs[offset / 4 % SIM_REGFILE_WORDS] = value;
+}
+
+/**
+ * SoC controller
+ */
+
+static sim_regfile_t sim_soc_ctrl;
+
+static void sim_soc_ctrl_write32(void *ctx, ptrdiff_t offset, uint32_t value) {
+  sim_regfile_write32(ctx, offset, value);
+  if (offset == SOC_CTRL_EXIT_VALID_REG_OFFSET && (value & 1)) {
+    sim_uart_flush(&sim_uart);
+    exit((int)sim_soc_ctrl.regs[SOC_CTRL_EXIT_VALUE_REG_OFFSET / 4]);
+  }
+}
+
+void sim_soc_ctrl_init(uint32_t freq_hz) {
+  sim_soc_ctrl.regs[SOC_CTRL_SYSTEM_FREQUENCY_HZ_REG_OFFSET / 4] = freq_hz;
+  sim_mmio_register(&(sim_periph_t){
+      .name = "soc_ctrl",
+      .base = SOC_CTRL_START_ADDRESS,
+      .size = SOC_CTRL_SIZE,
+      .read32 = sim_regfile_read32,
+      .write32 = sim_soc_ctrl_write32,
+      .ctx = &sim_soc_ctrl,
+  });
+}
+
+/**
+ * GPIO
+ */
+
+static sim_regfile_t sim_gpio_ao;
+static sim_regfile_t sim_gpio;
+
+void sim_gpio_init(void) {
+  sim_mmio_register(&(sim_periph_t){
+      .name = "gpio_ao",
+      .base = GPIO_AO_START_ADDRESS,
+      .size = GPIO_AO_SIZE,
+      .read32 = sim_regfile_read32,
+      .write32 = sim_regfile_write32,
+      .ctx = &sim_gpio_ao,
+  });
+  sim_mmio_register(&(sim_periph_t){
+      .name = "gpio",
+      .base = GPIO_START_ADDRESS,
+      .size = GPIO_SIZE,
+      .read32 = sim_regfile_read32,
+      .write32 = sim_regfile_write32,
+      .ctx = &sim_gpio,
+  });
+}
@@ -0,0 +1,35 @@
+// Copyright EPFL contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef _HOST_SIM_PERIPH_H_
+#define _HOST_SIM_PERIPH_H_
+
+#include <stdint.h>
+
+/**
+ * Simulated X-HEEP peripherals for host builds, see sim_mmio.h.
+ */
+
+/**
+ * Map the UART at UART_START_ADDRESS onto two file descriptors. STATUS
+ * reports RXEMPTY until `rx_fd` is readable and the TX FIFO as always idle;
+ * WDATA bytes are buffered and written to `tx_fd` on newline or before
+ * waiting for input. End of file on `rx_fd` terminates the process.
+ */
+void sim_uart_init(int rx_fd, int tx_fd);
+
+/**
+ * Map the SoC controller at SOC_CTRL_START_ADDRESS. SYSTEM_FREQUENCY_HZ reads
+ * back `freq_hz`; a write to EXIT_VALID terminates the process with the
+ * EXIT_VALUE status.
+ */
+void sim_soc_ctrl_init(uint32_t freq_hz);
+
+/**
+ * Map GPIO_AO and GPIO as plain register files, so GPIO markers (e.g. those
+ * of perf_region) are accepted and ignored.
+ */
+void sim_gpio_init(void);
+
+#endif  // _HOST_SIM_PERIPH_H_
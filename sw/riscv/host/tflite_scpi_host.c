@@ -0,0 +1,102 @@
+// Copyright EPFL contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+// Host-native build of the tflite_scpi inference server. The SCPI handlers,
+// the UART driver and the perf helpers are the firmware sources, compiled
+// with -DMOCK_MMIO -DMOCK_CSR against the simulated peripherals of
+// sim_periph.c. There is no U-mode and no request ring: lines go straight
+// from scpi_server_readline() to scpi_server_input(), as the M-mode side does
+// for each descriptor.
+//
+// The UART is stdin/stdout by default, so a session can be scripted:
+//
+//   printf '*IDN?\nNN:INFE:EXAM?\nEXIT\n' | ./host/tflite_scpi_host
+//
+// With --pty it is a pseudo-terminal instead, whose name is printed on
+// stderr; x_heep_scpi.XHeepScpiClient can then be pointed at it. Console
+// output (printf) always goes to stderr.
+//
+// Build from sw/riscv with `make host/tflite_scpi_host`.
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "core_v_mini_mcu.h"
+#include "lenet5_test.h"
+#include "scpi_server.h"
+#include "sim_mmio.h"
+#include "sim_periph.h"
+#include "soc_ctrl.h"
+#include "uart.h"
+
+#define HOST_SYSTEM_FREQUENCY_HZ 20000000u
+
+// Same line length as the U-mode loop on the board (TEE_RING_LINE)
+#define HOST_LINE 2048
+
+uart_t uart;
+volatile int exit_scpi = 0;
+
+static char line[HOST_LINE];
+
+static int open_pty(void) {
+  int fd = posix_openpt(O_RDWR | O_NOCTTY);
+  if (fd < 0 || grantpt(fd) != 0 || unlockpt(fd) != 0) {
+    perror("pty");
+    exit(EXIT_FAILURE);
+  }
+  // Raw mode on the slave side, like the board UART
+  int slave = open(ptsname(fd), O_RDWR | O_NOCTTY);
+  struct termios tio;
+  if (slave >= 0 && tcgetattr(slave, &tio) == 0) {
+    cfmakeraw(&tio);
+    tcsetattr(slave, TCSANOW, &tio);
+  }
+  fprintf(stderr, "UART on %s\n", ptsname(fd));
+  return fd;
+}
+
+int main(int argc, char **argv) {
+  int rx_fd = STDIN_FILENO;
+  int tx_fd = dup(STDOUT_FILENO);
+
+  if (argc > 1 && strcmp(argv[1], "--pty") == 0) {
+    rx_fd = tx_fd = open_pty();
+  } else if (argc > 1) {
+    fprintf(stderr, "usage: %s [--pty]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  // Keep the UART stream clean of console output
+  dup2(STDERR_FILENO, STDOUT_FILENO);
+
+  sim_soc_ctrl_init(HOST_SYSTEM_FREQUENCY_HZ);
+  sim_uart_init(rx_fd, tx_fd);
+  sim_gpio_init();
+
+  soc_ctrl_t soc_ctrl;
+  soc_ctrl.base_addr = mmio_region_from_addr((uintptr_t)SOC_CTRL_START_ADDRESS);
+  uart.base_addr = mmio_region_from_addr((uintptr_t)UART_START_ADDRESS);
+  uart.baudrate = 115200;
+  uart.clk_freq_hz = soc_ctrl_get_frequency(&soc_ctrl);
+  if (uart_init((const uart_t *)&uart) != kErrorOk) {
+    fprintf(stderr, "uart_init failed\n");
+    return EXIT_FAILURE;
+  }
+
+  scpi_server_init();
+  init_tflite();
+  printf("Initialized TFLite\r\n");
+
+  while (!exit_scpi) {
+    uint32_t len = scpi_server_readline(line, sizeof(line));
+    scpi_server_input(line, len);
+  }
+  return EXIT_SUCCESS;
+}
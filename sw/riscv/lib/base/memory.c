@@ -4,6 +4,8 @@
 
 #include "memory.h"
 
+#include <stdbool.h>
+
 extern uint32_t read_32(const void *);
 extern void write_32(uint32_t, void *);
 
@@ -18,22 +20,99 @@ extern void write_32(uint32_t, void *);
 // built for host-side software.
 
 #if !defined(HOST_BUILD)
+// Keep GCC from recognising the loops below as memcpy/memset idioms and
+// turning them back into calls to themselves.
+#define MEMORY_NO_LIBCALL \
+  __attribute__((optimize("no-tree-loop-distribute-patterns")))
+
+enum {
+  kWordMask = sizeof(uint32_t) - 1,
+};
+
+// Outside the range of int, so not enumerators
+static const uint32_t kOnesWord = 0x01010101u;
+static const uint32_t kHighsWord = 0x80808080u;
+
+static inline bool is_word_aligned(const void *ptr) {
+  return ((uintptr_t)ptr & kWordMask) == 0;
+}
+
+MEMORY_NO_LIBCALL
 void *memcpy(void *restrict dest, const void *restrict src, size_t len) {
   uint8_t *dest8 = (uint8_t *)dest;
-  uint8_t *src8 = (uint8_t *)src;
-  for (size_t i = 0; i < len; ++i) {
-    dest8[i] = src8[i];
+  const uint8_t *src8 = (const uint8_t *)src;
+
+  // Word copies are only possible when both pointers share their alignment.
+  if ((((uintptr_t)dest8 ^ (uintptr_t)src8) & kWordMask) == 0) {
+    while (len > 0 && !is_word_aligned(dest8)) {
+      *dest8++ = *src8++;
+      --len;
+    }
+    while (len >= 4 * sizeof(uint32_t)) {
+      uint32_t w0 = read_32(src8);
+      uint32_t w1 = read_32(src8 + 4);
+      uint32_t w2 = read_32(src8 + 8);
+      uint32_t w3 = read_32(src8 + 12);
+      write_32(w0, dest8);
+      write_32(w1, dest8 + 4);
+      write_32(w2, dest8 + 8);
+      write_32(w3, dest8 + 12);
+      dest8 += 4 * sizeof(uint32_t);
+      src8 += 4 * sizeof(uint32_t);
+      len -= 4 * sizeof(uint32_t);
+    }
+    while (len >= sizeof(uint32_t)) {
+      write_32(read_32(src8), dest8);
+      dest8 += sizeof(uint32_t);
+      src8 += sizeof(uint32_t);
+      len -= sizeof(uint32_t);
+    }
+  } else {
+    while (len >= 4) {
+      dest8[0] = src8[0];
+      dest8[1] = src8[1];
+      dest8[2] = src8[2];
+      dest8[3] = src8[3];
+      dest8 += 4;
+      src8 += 4;
+      len -= 4;
+    }
+  }
+  while (len > 0) {
+    *dest8++ = *src8++;
+    --len;
   }
   return dest;
 }
 #endif  // !defined(HOST_BUILD)
 
 #if !defined(HOST_BUILD)
+MEMORY_NO_LIBCALL
 void *memset(void *dest, int value, size_t len) {
   uint8_t *dest8 = (uint8_t *)dest;
   uint8_t value8 = (uint8_t)value;
-  for (size_t i = 0; i < len; ++i) {
-    dest8[i] = value8;
+  uint32_t value32 = value8 * kOnesWord;
+
+  while (len > 0 && !is_word_aligned(dest8)) {
+    *dest8++ = value8;
+    --len;
+  }
+  while (len >= 4 * sizeof(uint32_t)) {
+    write_32(value32, dest8);
+    write_32(value32, dest8 + 4);
+    write_32(value32, dest8 + 8);
+    write_32(value32, dest8 + 12);
+    dest8 += 4 * sizeof(uint32_t);
+    len -= 4 * sizeof(uint32_t);
+  }
+  while (len >= sizeof(uint32_t)) {
+    write_32(value32, dest8);
+    dest8 += sizeof(uint32_t);
+    len -= sizeof(uint32_t);
+  }
+  while (len > 0) {
+    *dest8++ = value8;
+    --len;
   }
   return dest;
 }
@@ -46,9 +125,28 @@ enum {
   kMemCmpGt = 42,
 };
 
+MEMORY_NO_LIBCALL
 int memcmp(const void *lhs, const void *rhs, size_t len) {
   const uint8_t *lhs8 = (uint8_t *)lhs;
   const uint8_t *rhs8 = (uint8_t *)rhs;
+
+  // Skip equal words quickly; the byte loop below settles the ordering of the
+  // first differing word, so results match a plain byte-wise comparison.
+  if ((((uintptr_t)lhs8 ^ (uintptr_t)rhs8) & kWordMask) == 0) {
+    while (len > 0 && !is_word_aligned(lhs8)) {
+      if (*lhs8 != *rhs8) {
+        return *lhs8 < *rhs8 ? kMemCmpLt : kMemCmpGt;
+      }
+      ++lhs8;
+      ++rhs8;
+      --len;
+    }
+    while (len >= sizeof(uint32_t) && read_32(lhs8) == read_32(rhs8)) {
+      lhs8 += sizeof(uint32_t);
+      rhs8 += sizeof(uint32_t);
+      len -= sizeof(uint32_t);
+    }
+  }
   for (size_t i = 0; i < len; ++i) {
     if (lhs8[i] < rhs8[i]) {
       return kMemCmpLt;
@@ -61,9 +159,28 @@ int memcmp(const void *lhs, const void *rhs, size_t len) {
 #endif  // !defined(HOST_BUILD)
 
 #if !defined(HOST_BUILD)
+MEMORY_NO_LIBCALL
 void *memchr(const void *ptr, int value, size_t len) {
   uint8_t *ptr8 = (uint8_t *)ptr;
   uint8_t value8 = (uint8_t)value;
+  uint32_t value32 = value8 * kOnesWord;
+
+  while (len > 0 && !is_word_aligned(ptr8)) {
+    if (*ptr8 == value8) {
+      return ptr8;
+    }
+    ++ptr8;
+    --len;
+  }
+  // A word contains `value8` iff (word ^ value32) has a zero byte.
+  while (len >= sizeof(uint32_t)) {
+    uint32_t x = read_32(ptr8) ^ value32;
+    if (((x - kOnesWord) & ~x & kHighsWord) != 0) {
+      break;
+    }
+    ptr8 += sizeof(uint32_t);
+    len -= sizeof(uint32_t);
+  }
   for (size_t i = 0; i < len; ++i) {
     if (ptr8[i] == value8) {
       return ptr8 + i;
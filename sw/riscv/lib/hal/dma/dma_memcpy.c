@@ -0,0 +1,100 @@
+// Copyright EPFL contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "dma_memcpy.h"
+
+#include <string.h>
+
+#include "dma_queue.h"
+
+// The service keeps one transfer of its own in flight; callers wanting more
+// should queue their own descriptors with dma_queue_submit().
+static dma_desc_t dma_memcpy_desc;
+static dma_memcpy_callback_t dma_memcpy_callback;
+
+// Source of fills: read repeatedly with a zero read increment.
+static uint32_t dma_memcpy_fill_word;
+
+static void dma_memcpy_done(dma_desc_t *desc, void *arg) {
+  (void)desc;
+  dma_memcpy_callback_t callback = dma_memcpy_callback;
+  dma_memcpy_callback = NULL;
+  if (callback != NULL) {
+    callback(arg);
+  }
+}
+
+void dma_memcpy_init(void) {
+  dma_memcpy_desc.state = kDmaDescIdle_e;
+  dma_memcpy_callback = NULL;
+  dma_queue_init();
+}
+
+void *dma_memcpy(void *dest, const void *src, size_t len) {
+  if (len < DMA_MEMCPY_CPU_THRESHOLD) {
+    return memcpy(dest, src, len);
+  }
+  dma_memcpy_async(dest, src, len, NULL, NULL);
+  dma_memcpy_wait();
+  return dest;
+}
+
+void *dma_memset(void *dest, int value, size_t len) {
+  if (len < DMA_MEMCPY_CPU_THRESHOLD) {
+    return memset(dest, value, len);
+  }
+  dma_memset_async(dest, value, len, NULL, NULL);
+  dma_memcpy_wait();
+  return dest;
+}
+
+dma_memcpy_result_t dma_memcpy_async(void *dest, const void *src, size_t len,
+                                     dma_memcpy_callback_t callback, void *arg) {
+  if (len > 0 && (dest == NULL || src == NULL)) {
+    return kDmaMemcpyError_e;
+  }
+  if (len < DMA_MEMCPY_CPU_THRESHOLD) {
+    memcpy(dest, src, len);
+    if (callback != NULL) {
+      callback(arg);
+    }
+    return kDmaMemcpyOk_e;
+  }
+  dma_memcpy_wait();
+  dma_memcpy_callback = callback;
+  dma_desc_mem_to_mem(&dma_memcpy_desc, dest, src, len, dma_memcpy_done, arg);
+  dma_queue_submit(&dma_memcpy_desc);
+  return kDmaMemcpyOk_e;
+}
+
+dma_memcpy_result_t dma_memset_async(void *dest, int value, size_t len,
+                                     dma_memcpy_callback_t callback, void *arg) {
+  if (len > 0 && dest == NULL) {
+    return kDmaMemcpyError_e;
+  }
+  if (len < DMA_MEMCPY_CPU_THRESHOLD) {
+    memset(dest, value, len);
+    if (callback != NULL) {
+      callback(arg);
+    }
+    return kDmaMemcpyOk_e;
+  }
+  // The descriptor and fill word are shared with the previous transfer.
+  dma_memcpy_wait();
+  dma_memcpy_callback = callback;
+  dma_memcpy_fill_word = (uint8_t)value * 0x01010101u;
+  dma_desc_fill(&dma_memcpy_desc, dest, &dma_memcpy_fill_word, len,
+                dma_memcpy_done, arg);
+  dma_queue_submit(&dma_memcpy_desc);
+  return kDmaMemcpyOk_e;
+}
+
+bool dma_memcpy_busy(void) {
+  return dma_memcpy_desc.state == kDmaDescQueued_e ||
+         dma_memcpy_desc.state == kDmaDescActive_e;
+}
+
+void dma_memcpy_wait(void) {
+  dma_queue_wait(&dma_memcpy_desc);
+}
@@ -0,0 +1,103 @@
+// Copyright EPFL contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef _DRIVERS_DMA_MEMCPY_H_
+#define _DRIVERS_DMA_MEMCPY_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "dma.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Transfers shorter than this many bytes are done by the CPU: programming the
+ * DMA and taking its interrupt costs more than copying a few words.
+ */
+#ifndef DMA_MEMCPY_CPU_THRESHOLD
+#define DMA_MEMCPY_CPU_THRESHOLD 64
+#endif
+
+/**
+ * Completion callback of an asynchronous transfer. It runs from
+ * `handler_irq_fast_dma` (or from a wait loop when interrupts are globally
+ * disabled), so it must be short and must not start a synchronous transfer.
+ */
+typedef void (*dma_memcpy_callback_t)(void *arg);
+
+/**
+ * Result of a DMA copy service call.
+ */
+typedef enum dma_memcpy_result {
+  kDmaMemcpyOk_e    = 0,
+  kDmaMemcpyError_e = 1,
+} dma_memcpy_result_t;
+
+/**
+ * Initializes the service and the DMA queue it submits to (see
+ * `dma_queue_init`). Transfers are queued behind any other descriptors.
+ */
+void dma_memcpy_init(void);
+
+/**
+ * Copies `len` bytes from `src` to `dest` and waits for the copy to finish.
+ * A previous asynchronous copy is completed first. Regions must not overlap.
+ * @param dest Destination buffer.
+ * @param src Source buffer.
+ * @param len Number of bytes to copy.
+ * @return `dest`, like memcpy.
+ */
+void *dma_memcpy(void *dest, const void *src, size_t len);
+
+/**
+ * Fills `len` bytes at `dest` with `value` and waits for the fill to finish.
+ * @param dest Destination buffer.
+ * @param value Byte value to store.
+ * @param len Number of bytes to fill.
+ * @return `dest`, like memset.
+ */
+void *dma_memset(void *dest, int value, size_t len);
+
+/**
+ * Starts copying `len` bytes from `src` to `dest` and returns immediately.
+ * `callback` (may be NULL) is called once the copy is complete. Short copies
+ * are done by the CPU before returning and call `callback` directly. Neither
+ * buffer may be touched until completion.
+ * @param dest Destination buffer.
+ * @param src Source buffer.
+ * @param len Number of bytes to copy.
+ * @param callback Completion callback, or NULL.
+ * @param arg Argument passed to `callback`.
+ * @return kDmaMemcpyOk_e, or kDmaMemcpyError_e if a buffer is NULL.
+ */
+dma_memcpy_result_t dma_memcpy_async(void *dest, const void *src, size_t len,
+                                     dma_memcpy_callback_t callback, void *arg);
+
+/**
+ * Starts filling `len` bytes at `dest` with `value` and returns immediately.
+ * See `dma_memcpy_async` for the completion rules.
+ */
+dma_memcpy_result_t dma_memset_async(void *dest, int value, size_t len,
+                                     dma_memcpy_callback_t callback, void *arg);
+
+/**
+ * @return true while an asynchronous transfer is in flight.
+ */
+bool dma_memcpy_busy(void);
+
+/**
+ * Sleeps until the transfer in flight (if any) has completed and its callback
+ * has run.
+ */
+void dma_memcpy_wait(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _DRIVERS_DMA_MEMCPY_H_
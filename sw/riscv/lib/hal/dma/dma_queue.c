@@ -0,0 +1,205 @@
+// Copyright EPFL contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "dma_queue.h"
+
+#include "core_v_mini_mcu.h"
+#include "csr.h"
+#include "fast_intr_ctrl.h"
+#include "mmio.h"
+
+// MIE bit of the fast DMA interrupt (fast interrupts start at 16).
+#define DMA_QUEUE_MIE_MASK (1u << (16 + kDma_fic_e))
+
+static dma_t dma_queue_dma;
+static fast_intr_ctrl_t dma_queue_fic;
+
+// `dma_queue_head` is the descriptor the hardware is working on; the rest of
+// the list is waiting behind it.
+static dma_desc_t *volatile dma_queue_head;
+static dma_desc_t *volatile dma_queue_tail;
+
+static inline uint32_t dma_queue_irq_save(void) {
+  uint32_t mstatus;
+  CSR_READ(CSR_REG_MSTATUS, &mstatus);
+  CSR_CLEAR_BITS(CSR_REG_MSTATUS, 0x8);
+  return mstatus;
+}
+
+static inline void dma_queue_irq_restore(uint32_t mstatus) {
+  if (mstatus & 0x8) {
+    CSR_SET_BITS(CSR_REG_MSTATUS, 0x8);
+  }
+}
+
+static void dma_queue_start(dma_desc_t *desc) {
+  desc->state = kDmaDescActive_e;
+  dma_set_read_ptr_inc(&dma_queue_dma, desc->src_inc);
+  dma_set_write_ptr_inc(&dma_queue_dma, desc->dst_inc);
+  dma_set_read_ptr(&dma_queue_dma, desc->src);
+  dma_set_write_ptr(&dma_queue_dma, desc->dst);
+  dma_set_spi_mode(&dma_queue_dma, desc->mode);
+  dma_set_data_type(&dma_queue_dma, desc->data_type);
+  dma_set_cnt_start(&dma_queue_dma, desc->len);
+}
+
+// Retires the active descriptor if the hardware has finished it. Must run
+// with interrupts masked or from the interrupt handler.
+static void dma_queue_complete(void) {
+  clear_fast_interrupt(&dma_queue_fic, kDma_fic_e);
+
+  dma_desc_t *done = dma_queue_head;
+  // A completion already handled by a wait loop can leave a stale interrupt
+  // behind; the done flag tells it apart from the running transfer.
+  if (done == NULL || !dma_get_done(&dma_queue_dma)) {
+    return;
+  }
+
+  // Chain the next transfer before running the callback so the DMA stays busy.
+  dma_queue_head = done->next;
+  if (dma_queue_head != NULL) {
+    dma_queue_start(dma_queue_head);
+  } else {
+    dma_queue_tail = NULL;
+  }
+
+  done->next = NULL;
+  done->state = kDmaDescDone_e;
+  if (done->callback != NULL) {
+    done->callback(done, done->arg);
+  }
+}
+
+static uint8_t dma_queue_unit(uint32_t alignment, uint8_t *data_type) {
+  if ((alignment & 0x3) == 0) {
+    *data_type = kDmaQueueWord_e;
+    return 4;
+  } else if ((alignment & 0x1) == 0) {
+    *data_type = kDmaQueueHalfWord_e;
+    return 2;
+  }
+  *data_type = kDmaQueueByte_e;
+  return 1;
+}
+
+static void dma_desc_set(dma_desc_t *desc, uint32_t dst, uint32_t src,
+                         size_t len, dma_queue_mode_t mode,
+                         dma_queue_callback_t callback, void *arg) {
+  desc->src = src;
+  desc->dst = dst;
+  desc->len = (uint32_t)len;
+  desc->mode = mode;
+  desc->callback = callback;
+  desc->arg = arg;
+  desc->state = kDmaDescIdle_e;
+  desc->next = NULL;
+}
+
+void dma_queue_init(void) {
+  dma_queue_dma.base_addr = mmio_region_from_addr((uintptr_t)DMA_START_ADDRESS);
+  dma_queue_fic.base_addr = mmio_region_from_addr((uintptr_t)FAST_INTR_CTRL_START_ADDRESS);
+  dma_queue_head = NULL;
+  dma_queue_tail = NULL;
+
+  clear_fast_interrupt(&dma_queue_fic, kDma_fic_e);
+  CSR_SET_BITS(CSR_REG_MIE, DMA_QUEUE_MIE_MASK);
+}
+
+void dma_desc_mem_to_mem(dma_desc_t *desc, void *dst, const void *src,
+                         size_t len, dma_queue_callback_t callback, void *arg) {
+  dma_desc_set(desc, (uint32_t)(uintptr_t)dst, (uint32_t)(uintptr_t)src, len,
+               kDmaQueueMemToMem_e, callback, arg);
+  uint8_t unit = dma_queue_unit(desc->dst | desc->src | desc->len,
+                                &desc->data_type);
+  desc->src_inc = unit;
+  desc->dst_inc = unit;
+}
+
+void dma_desc_fill(dma_desc_t *desc, void *dst, const uint32_t *pattern,
+                   size_t len, dma_queue_callback_t callback, void *arg) {
+  dma_desc_set(desc, (uint32_t)(uintptr_t)dst, (uint32_t)(uintptr_t)pattern,
+               len, kDmaQueueMemToMem_e, callback, arg);
+  uint8_t unit = dma_queue_unit(desc->dst | desc->len, &desc->data_type);
+  desc->src_inc = 0;
+  desc->dst_inc = unit;
+}
+
+void dma_desc_spi_rx(dma_desc_t *desc, dma_queue_mode_t mode, void *dst,
+                     volatile const void *fifo, size_t len,
+                     dma_queue_callback_t callback, void *arg) {
+  dma_desc_set(desc, (uint32_t)(uintptr_t)dst, (uint32_t)(uintptr_t)fifo, len,
+               mode, callback, arg);
+  desc->data_type = kDmaQueueWord_e;
+  desc->src_inc = 0;
+  desc->dst_inc = 4;
+}
+
+void dma_desc_spi_tx(dma_desc_t *desc, dma_queue_mode_t mode,
+                     volatile void *fifo, const void *src, size_t len,
+                     dma_queue_callback_t callback, void *arg) {
+  dma_desc_set(desc, (uint32_t)(uintptr_t)fifo, (uint32_t)(uintptr_t)src, len,
+               mode, callback, arg);
+  desc->data_type = kDmaQueueWord_e;
+  desc->src_inc = 4;
+  desc->dst_inc = 0;
+}
+
+dma_queue_result_t dma_queue_submit(dma_desc_t *desc) {
+  if (desc == NULL || desc->len == 0) {
+    return kDmaQueueError_e;
+  }
+  if (desc->state == kDmaDescQueued_e || desc->state == kDmaDescActive_e) {
+    return kDmaQueueBusy_e;
+  }
+
+  uint32_t mstatus = dma_queue_irq_save();
+  desc->next = NULL;
+  desc->state = kDmaDescQueued_e;
+  if (dma_queue_tail != NULL) {
+    dma_queue_tail->next = desc;
+    dma_queue_tail = desc;
+  } else {
+    dma_queue_head = desc;
+    dma_queue_tail = desc;
+    dma_queue_start(desc);
+  }
+  dma_queue_irq_restore(mstatus);
+  return kDmaQueueOk_e;
+}
+
+bool dma_queue_busy(void) {
+  return dma_queue_head != NULL;
+}
+
+// One step of a wait loop. Check and sleep with interrupts masked so the
+// completion cannot slip in between the two; wfi still wakes on the pending
+// DMA interrupt. If interrupts are globally off the handler never runs, so
+// retire the transfer here.
+static void dma_queue_wait_step(void) {
+  uint32_t mstatus = dma_queue_irq_save();
+  if (dma_queue_head != NULL) {
+    if (dma_get_done(&dma_queue_dma)) {
+      dma_queue_complete();
+    } else {
+      asm volatile("wfi");
+    }
+  }
+  dma_queue_irq_restore(mstatus);
+}
+
+void dma_queue_wait(dma_desc_t *desc) {
+  while (desc->state == kDmaDescQueued_e || desc->state == kDmaDescActive_e) {
+    dma_queue_wait_step();
+  }
+}
+
+void dma_queue_wait_all(void) {
+  while (dma_queue_head != NULL) {
+    dma_queue_wait_step();
+  }
+}
+
+void dma_queue_irq_handler(void) {
+  dma_queue_complete();
+}
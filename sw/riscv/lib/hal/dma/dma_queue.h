@@ -0,0 +1,161 @@
+// Copyright EPFL contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef _DRIVERS_DMA_QUEUE_H_
+#define _DRIVERS_DMA_QUEUE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "dma.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Transfer direction, as programmed into the DMA spi_mode register.
+ */
+typedef enum dma_queue_mode {
+  kDmaQueueMemToMem_e      = 0,
+  kDmaQueueSpiRxToMem_e    = 1,
+  kDmaQueueMemToSpiTx_e    = 2,
+  kDmaQueueFlashRxToMem_e  = 3,
+  kDmaQueueMemToFlashTx_e  = 4,
+} dma_queue_mode_t;
+
+/**
+ * Beat width, as programmed into the DMA data_type register.
+ */
+typedef enum dma_queue_data_type {
+  kDmaQueueWord_e     = 0,
+  kDmaQueueHalfWord_e = 1,
+  kDmaQueueByte_e     = 2,
+} dma_queue_data_type_t;
+
+/**
+ * Life cycle of a descriptor. Only `kDmaDescIdle_e` and `kDmaDescDone_e`
+ * descriptors may be modified or resubmitted by the caller.
+ */
+typedef enum dma_desc_state {
+  kDmaDescIdle_e   = 0,
+  kDmaDescQueued_e = 1,
+  kDmaDescActive_e = 2,
+  kDmaDescDone_e   = 3,
+} dma_desc_state_t;
+
+typedef struct dma_desc dma_desc_t;
+
+/**
+ * Completion callback. It runs in interrupt context after the next queued
+ * transfer has already been started, and may submit new descriptors
+ * (including `desc` itself) to keep a stream going.
+ */
+typedef void (*dma_queue_callback_t)(dma_desc_t *desc, void *arg);
+
+/**
+ * One DMA transfer. Descriptors are owned by the caller and linked into the
+ * queue in place, so they must stay alive until they reach `kDmaDescDone_e`.
+ * Fill them with the `dma_desc_*` helpers.
+ */
+struct dma_desc {
+  uint32_t src;
+  uint32_t dst;
+  uint32_t len;
+  uint8_t src_inc;
+  uint8_t dst_inc;
+  uint8_t mode;
+  uint8_t data_type;
+  dma_queue_callback_t callback;
+  void *arg;
+  volatile dma_desc_state_t state;
+  dma_desc_t *next;
+};
+
+/**
+ * Result of a DMA queue call.
+ */
+typedef enum dma_queue_result {
+  kDmaQueueOk_e    = 0,
+  kDmaQueueError_e = 1,
+  kDmaQueueBusy_e  = 2,
+} dma_queue_result_t;
+
+/**
+ * Binds the queue to the DMA at `DMA_START_ADDRESS` and enables the fast
+ * DMA interrupt in MIE. MSTATUS.MIE is left to the caller; without it
+ * completions are still processed by the wait functions.
+ */
+void dma_queue_init(void);
+
+/**
+ * Describes a memory-to-memory copy. The beat width is the widest one that
+ * `dst`, `src` and `len` are all aligned to.
+ */
+void dma_desc_mem_to_mem(dma_desc_t *desc, void *dst, const void *src,
+                         size_t len, dma_queue_callback_t callback, void *arg);
+
+/**
+ * Describes a fill of `len` bytes at `dst` from the word at `pattern`, which
+ * is read repeatedly and must stay valid until completion.
+ */
+void dma_desc_fill(dma_desc_t *desc, void *dst, const uint32_t *pattern,
+                   size_t len, dma_queue_callback_t callback, void *arg);
+
+/**
+ * Describes a drain of `len` bytes from a SPI RX FIFO into memory, paced by
+ * the SPI. The SPI command producing the data is issued by the caller.
+ * @param mode kDmaQueueSpiRxToMem_e or kDmaQueueFlashRxToMem_e.
+ * @param fifo Address of the SPI RXDATA register.
+ */
+void dma_desc_spi_rx(dma_desc_t *desc, dma_queue_mode_t mode, void *dst,
+                     volatile const void *fifo, size_t len,
+                     dma_queue_callback_t callback, void *arg);
+
+/**
+ * Describes a feed of `len` bytes from memory into a SPI TX FIFO.
+ * @param mode kDmaQueueMemToSpiTx_e or kDmaQueueMemToFlashTx_e.
+ * @param fifo Address of the SPI TXDATA register.
+ */
+void dma_desc_spi_tx(dma_desc_t *desc, dma_queue_mode_t mode,
+                     volatile void *fifo, const void *src, size_t len,
+                     dma_queue_callback_t callback, void *arg);
+
+/**
+ * Appends `desc` to the queue and starts it right away if the DMA is idle.
+ * Safe to call from a completion callback.
+ * @return kDmaQueueOk_e, kDmaQueueBusy_e if `desc` is still queued or active,
+ * or kDmaQueueError_e if it is empty.
+ */
+dma_queue_result_t dma_queue_submit(dma_desc_t *desc);
+
+/**
+ * @return true while any descriptor is queued or active.
+ */
+bool dma_queue_busy(void);
+
+/**
+ * Sleeps until `desc` is done and its callback has returned.
+ */
+void dma_queue_wait(dma_desc_t *desc);
+
+/**
+ * Sleeps until the whole queue has drained.
+ */
+void dma_queue_wait_all(void);
+
+/**
+ * Acknowledges the fast DMA interrupt, starts the next queued descriptor and
+ * runs the finished one's callback. Called by the default
+ * `handler_irq_fast_dma`; applications overriding that handler and using the
+ * queue must call it themselves.
+ */
+void dma_queue_irq_handler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _DRIVERS_DMA_QUEUE_H_
@@ -11,6 +11,7 @@
 #include <stdint.h>
 
 #include "bitfield.h"
+#include "csr.h"
 #include "mmio.h"
 #include "error.h"
 
@@ -87,16 +88,21 @@ static bool uart_rx_empty(const uart_t *uart) {
   return bitfield_bit32_read(reg, UART_STATUS_RXEMPTY_BIT);
 }
 
-void uart_putchar(const uart_t *uart, uint8_t byte) {
-  // If the transmit FIFO is full, wait.
-  while (uart_tx_full(uart)) {
-  }
+static void uart_tx_fifo_write(const uart_t *uart, uint8_t byte) {
   uint32_t reg = bitfield_field32_write(0, UART_WDATA_WDATA_FIELD, byte);
   mmio_region_write32(uart->base_addr, UART_WDATA_REG_OFFSET, reg);
+}
 
-  // If the transmitter is active, wait.
-  while (!uart_tx_idle(uart)) {
+void uart_putchar(const uart_t *uart, uint8_t byte) {
+  // Bytes queued by uart_write_async() go out first.
+  if (uart_tx_pending(uart) > 0) {
+    uart_flush_async(uart);
+  }
+  // If the transmit FIFO is full, wait. The FIFO drains on its own, so there
+  // is no need to wait for the transmitter to go idle after every byte.
+  while (uart_tx_full(uart)) {
   }
+  uart_tx_fifo_write(uart, byte);
 }
 
 static uint8_t uart_rx_fifo_read(const uart_t *uart) {
@@ -105,15 +111,6 @@ static uint8_t uart_rx_fifo_read(const uart_t *uart) {
   return bitfield_field32_read(reg, UART_RDATA_RDATA_FIELD);
 }
 
-/**
-* Read 1 byte from the RX FIFO.
-*/
-size_t uart_getchar(const uart_t *uart, uint8_t *data) {
-  while (uart_rx_empty(uart));
-  *data = uart_rx_fifo_read(uart);
-  return 1;
-}
-
 /**
  * Write `len` bytes to the UART TX FIFO.
  */
@@ -124,13 +121,17 @@ size_t uart_write(const uart_t *uart, const uint8_t *data, size_t len) {
     data++;
     len--;
   }
+
+  // Wait once for the whole buffer to leave the transmitter.
+  while (!uart_tx_idle(uart)) {
+  }
   return total;
 }
 
 /**
  * Read `len` bytes from the UART RX FIFO.
  */
-size_t uart_read(const uart_t *uart, const uint8_t *data, size_t len) {
+size_t uart_read(const uart_t *uart, uint8_t *data, size_t len) {
   size_t total = len;
   while (len) {
     uart_getchar(uart, data);
@@ -143,3 +144,291 @@ size_t uart_read(const uart_t *uart, const uint8_t *data, size_t len) {
 size_t uart_sink(void *uart, const char *data, size_t len) {
   return uart_write((const uart_t *)uart, (const uint8_t *)data, len);
 }
+
+/**
+ * Interrupt-driven operation.
+ *
+ * X-HEEP has a single UART, so the ring buffers are driver-global. The main
+ * code only moves the TX head and the RX tail, the interrupt handler only
+ * moves the TX tail and the RX head.
+ */
+#define UART_FIFO_DEPTH 32
+
+_Static_assert((UART_TX_RING_SIZE & (UART_TX_RING_SIZE - 1)) == 0,
+               "UART_TX_RING_SIZE must be a power of two");
+_Static_assert((UART_RX_RING_SIZE & (UART_RX_RING_SIZE - 1)) == 0,
+               "UART_RX_RING_SIZE must be a power of two");
+
+static uint8_t uart_tx_ring[UART_TX_RING_SIZE];
+static volatile size_t uart_tx_head = 0;
+static volatile size_t uart_tx_tail = 0;
+
+static uint8_t uart_rx_ring[UART_RX_RING_SIZE];
+static volatile size_t uart_rx_head = 0;
+static volatile size_t uart_rx_tail = 0;
+static volatile size_t uart_rx_dropped = 0;
+
+// Set by uart_async_init(): received bytes then go through the RX ring.
+static bool uart_async = false;
+
+static size_t uart_tx_ring_count(void) {
+  return (uart_tx_head - uart_tx_tail) & (UART_TX_RING_SIZE - 1);
+}
+
+static size_t uart_rx_ring_count(void) {
+  return (uart_rx_head - uart_rx_tail) & (UART_RX_RING_SIZE - 1);
+}
+
+static inline uint32_t uart_irq_save(void) {
+  uint32_t mstatus;
+  CSR_READ(CSR_REG_MSTATUS, &mstatus);
+  CSR_CLEAR_BITS(CSR_REG_MSTATUS, 0x8);
+  return mstatus;
+}
+
+static inline void uart_irq_restore(uint32_t mstatus) {
+  if (mstatus & 0x8) {
+    CSR_SET_BITS(CSR_REG_MSTATUS, 0x8);
+  }
+}
+
+static void uart_set_intr(const uart_t *uart, uint32_t mask, bool enable) {
+  uint32_t reg = mmio_region_read32(uart->base_addr, UART_INTR_ENABLE_REG_OFFSET);
+  reg = enable ? (reg | mask) : (reg & ~mask);
+  mmio_region_write32(uart->base_addr, UART_INTR_ENABLE_REG_OFFSET, reg);
+}
+
+#define UART_INTR_TX_MASK                          \
+  ((1u << UART_INTR_ENABLE_TX_WATERMARK_BIT) |     \
+   (1u << UART_INTR_ENABLE_TX_EMPTY_BIT))
+#define UART_INTR_RX_MASK                          \
+  ((1u << UART_INTR_ENABLE_RX_WATERMARK_BIT) |     \
+   (1u << UART_INTR_ENABLE_RX_TIMEOUT_BIT) |       \
+   (1u << UART_INTR_ENABLE_RX_OVERFLOW_BIT))
+
+/**
+ * Move bytes from the TX ring into the hardware FIFO until either is
+ * exhausted. Returns true if the ring still holds data.
+ */
+static bool uart_tx_refill(const uart_t *uart) {
+  while (uart_tx_head != uart_tx_tail && !uart_tx_full(uart)) {
+    uart_tx_fifo_write(uart, uart_tx_ring[uart_tx_tail]);
+    uart_tx_tail = (uart_tx_tail + 1) & (UART_TX_RING_SIZE - 1);
+  }
+  return uart_tx_head != uart_tx_tail;
+}
+
+/**
+ * What the TX interrupt does, for callers running with interrupts masked.
+ */
+static void uart_tx_service(const uart_t *uart) {
+  if (!uart_tx_refill(uart)) {
+    uart_set_intr(uart, UART_INTR_TX_MASK, false);
+  }
+}
+
+static void uart_rx_drain(const uart_t *uart) {
+  while (!uart_rx_empty(uart)) {
+    uint8_t byte = uart_rx_fifo_read(uart);
+    size_t next = (uart_rx_head + 1) & (UART_RX_RING_SIZE - 1);
+    if (next == uart_rx_tail) {
+      uart_rx_dropped++;
+      continue;
+    }
+    uart_rx_ring[uart_rx_head] = byte;
+    uart_rx_head = next;
+  }
+}
+
+system_error_t uart_set_watermarks(const uart_t *uart, uart_rx_watermark_t rx,
+                                   uart_tx_watermark_t tx) {
+  if (uart == NULL || rx > kUartRxWatermark30 || tx > kUartTxWatermark16) {
+    return kErrorUartInvalidArgument;
+  }
+  // RXRST/TXRST are left at zero so the FIFO contents survive.
+  uint32_t reg = 0;
+  reg = bitfield_field32_write(reg, UART_FIFO_CTRL_RXILVL_FIELD, rx);
+  reg = bitfield_field32_write(reg, UART_FIFO_CTRL_TXILVL_FIELD, tx);
+  mmio_region_write32(uart->base_addr, UART_FIFO_CTRL_REG_OFFSET, reg);
+  return kErrorOk;
+}
+
+system_error_t uart_async_init(const uart_t *uart, uart_rx_watermark_t rx,
+                               uart_tx_watermark_t tx) {
+  system_error_t res = uart_set_watermarks(uart, rx, tx);
+  if (res != kErrorOk) {
+    return res;
+  }
+
+  uart_tx_head = uart_tx_tail = 0;
+  uart_rx_head = uart_rx_tail = 0;
+  uart_rx_dropped = 0;
+  uart_async = true;
+
+  // Flush partial RX bursts below the watermark after ~4 character times.
+  uint32_t timeout = 0;
+  timeout = bitfield_field32_write(timeout, UART_TIMEOUT_CTRL_VAL_FIELD, 40);
+  timeout = bitfield_bit32_write(timeout, UART_TIMEOUT_CTRL_EN_BIT, true);
+  mmio_region_write32(uart->base_addr, UART_TIMEOUT_CTRL_REG_OFFSET, timeout);
+
+  mmio_region_write32(uart->base_addr, UART_INTR_STATE_REG_OFFSET, UINT32_MAX);
+  uart_set_intr(uart, UART_INTR_TX_MASK, false);
+  uart_set_intr(uart, UART_INTR_RX_MASK, true);
+  return kErrorOk;
+}
+
+size_t uart_write_async(const uart_t *uart, const uint8_t *data, size_t len) {
+  size_t queued = 0;
+  while (queued < len) {
+    size_t next = (uart_tx_head + 1) & (UART_TX_RING_SIZE - 1);
+    if (next == uart_tx_tail) {
+      break;
+    }
+    uart_tx_ring[uart_tx_head] = data[queued++];
+    uart_tx_head = next;
+  }
+
+  // Prime the FIFO with interrupts masked: the handler also moves the tail.
+  uint32_t mstatus = uart_irq_save();
+  if (uart_tx_refill(uart)) {
+    uart_set_intr(uart, UART_INTR_TX_MASK, true);
+  }
+  uart_irq_restore(mstatus);
+  return queued;
+}
+
+void uart_tx_poll(const uart_t *uart) {
+  uint32_t mstatus = uart_irq_save();
+  uart_tx_service(uart);
+  uart_irq_restore(mstatus);
+}
+
+size_t uart_tx_pending(const uart_t *uart) {
+  (void)uart;
+  return uart_tx_ring_count();
+}
+
+/**
+ * The ring is checked with interrupts masked: a refill interrupt raised after
+ * the check is still pending and ends the wfi, so its wakeup is not lost.
+ * Called with interrupts off (e.g. from a trap handler), no handler would
+ * ever run, so the FIFO is refilled here instead.
+ */
+static void uart_flush_step(const uart_t *uart) {
+  uint32_t mstatus = uart_irq_save();
+  if (uart_tx_head != uart_tx_tail) {
+    if (mstatus & 0x8) {
+#ifndef MOCK_MMIO
+      asm volatile("wfi");
+#endif
+    } else {
+      uart_tx_service(uart);
+    }
+  }
+  uart_irq_restore(mstatus);
+}
+
+void uart_flush_async(const uart_t *uart) {
+  while (uart_tx_ring_count() > 0) {
+    uart_flush_step(uart);
+  }
+  while (!uart_tx_idle(uart)) {
+  }
+}
+
+size_t uart_read_available(const uart_t *uart) {
+  (void)uart;
+  return uart_rx_ring_count();
+}
+
+size_t uart_read_async(const uart_t *uart, uint8_t *data, size_t len) {
+  (void)uart;
+  size_t read = 0;
+  while (read < len && uart_rx_tail != uart_rx_head) {
+    data[read++] = uart_rx_ring[uart_rx_tail];
+    uart_rx_tail = (uart_rx_tail + 1) & (UART_RX_RING_SIZE - 1);
+  }
+  return read;
+}
+
+/**
+ * Move received bytes into the RX ring while it has room. Unlike the
+ * interrupt handler, which has to empty the FIFO, polling readers leave the
+ * rest in the FIFO instead of dropping it.
+ */
+static void uart_rx_fill(const uart_t *uart) {
+  size_t next = (uart_rx_head + 1) & (UART_RX_RING_SIZE - 1);
+  while (next != uart_rx_tail && !uart_rx_empty(uart)) {
+    uart_rx_ring[uart_rx_head] = uart_rx_fifo_read(uart);
+    uart_rx_head = next;
+    next = (next + 1) & (UART_RX_RING_SIZE - 1);
+  }
+}
+
+/**
+ * Like uart_flush_step(), for a reader waiting on an empty RX ring: sleep
+ * until the RX interrupt, or fill the ring here with interrupts off.
+ */
+static void uart_rx_step(const uart_t *uart) {
+  uint32_t mstatus = uart_irq_save();
+  if (uart_rx_head == uart_rx_tail) {
+    if (mstatus & 0x8) {
+#ifndef MOCK_MMIO
+      asm volatile("wfi");
+#endif
+    } else {
+      uart_rx_fill(uart);
+    }
+  }
+  uart_irq_restore(mstatus);
+}
+
+/**
+* Read 1 byte from the RX FIFO, or from the RX ring in interrupt-driven mode,
+* where the FIFO may already have been drained into it.
+*/
+size_t uart_getchar(const uart_t *uart, uint8_t *data) {
+  if (!uart_async) {
+    while (uart_rx_empty(uart));
+    *data = uart_rx_fifo_read(uart);
+    return 1;
+  }
+  while (uart_read_async(uart, data, 1) == 0) {
+    uart_rx_step(uart);
+  }
+  return 1;
+}
+
+bool uart_rx_ready(const uart_t *uart) {
+  if (!uart_async) {
+    return !uart_rx_empty(uart);
+  }
+  uint32_t mstatus = uart_irq_save();
+  if (uart_rx_head == uart_rx_tail) {
+    uart_rx_fill(uart);
+  }
+  bool ready = uart_rx_head != uart_rx_tail;
+  uart_irq_restore(mstatus);
+  return ready;
+}
+
+size_t uart_rx_dropped_count(const uart_t *uart) {
+  (void)uart;
+  return uart_rx_dropped;
+}
+
+void uart_irq_handler(const uart_t *uart) {
+  uint32_t state = mmio_region_read32(uart->base_addr, UART_INTR_STATE_REG_OFFSET);
+
+  if (state & UART_INTR_RX_MASK) {
+    uart_rx_drain(uart);
+  }
+  if (state & UART_INTR_TX_MASK) {
+    if (!uart_tx_refill(uart)) {
+      uart_set_intr(uart, UART_INTR_TX_MASK, false);
+    }
+  }
+
+  // Interrupt state bits are write-one-to-clear.
+  mmio_region_write32(uart->base_addr, UART_INTR_STATE_REG_OFFSET, state);
+}
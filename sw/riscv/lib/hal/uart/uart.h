@@ -8,12 +8,24 @@
 #ifndef _DRIVERS_UART_H_
 #define _DRIVERS_UART_H_
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
 #include "mmio.h"
 #include "error.h"
 
+/**
+ * Sizes of the software TX/RX rings used by the interrupt-driven API. Both
+ * must be powers of two; one slot is kept free to tell full from empty.
+ */
+#ifndef UART_TX_RING_SIZE
+#define UART_TX_RING_SIZE 512
+#endif
+#ifndef UART_RX_RING_SIZE
+#define UART_RX_RING_SIZE 256
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -37,6 +49,27 @@ typedef struct uart {
   uint32_t clk_freq_hz;
 } uart_t;
 
+/**
+ * RX FIFO level that raises the rx_watermark interrupt.
+ */
+typedef enum uart_rx_watermark {
+  kUartRxWatermark1 = 0,
+  kUartRxWatermark4 = 1,
+  kUartRxWatermark8 = 2,
+  kUartRxWatermark16 = 3,
+  kUartRxWatermark30 = 4,
+} uart_rx_watermark_t;
+
+/**
+ * TX FIFO level below which the tx_watermark interrupt is raised.
+ */
+typedef enum uart_tx_watermark {
+  kUartTxWatermark1 = 0,
+  kUartTxWatermark4 = 1,
+  kUartTxWatermark8 = 2,
+  kUartTxWatermark16 = 3,
+} uart_tx_watermark_t;
+
 /**
  * Initialize the UART with the request parameters.
  *
@@ -46,7 +79,8 @@ typedef struct uart {
 system_error_t uart_init(const uart_t *uart);
 
 /**
- * Write a single byte to the UART.
+ * Write a single byte to the UART. Bytes still queued by `uart_write_async()`
+ * are flushed first, so blocking and queued output keep their order.
  *
  * @param uart Pointer to uart_t represting the target UART.
  * @param byte Byte to send.
@@ -77,12 +111,121 @@ size_t uart_write(const uart_t *uart, const uint8_t *data, size_t len);
  * @return Number of bytes written.
  */
 
+/**
+ * Read one byte, waiting for it. After `uart_async_init()` the byte is taken
+ * from the RX ring, so bytes the interrupt handler already moved there are
+ * not skipped; with interrupts off the FIFO is drained into the ring here.
+ *
+ * @param uart Pointer to uart_t represting the target UART.
+ * @param data Where to store the byte.
+ * @return Number of bytes read (1).
+ */
 size_t uart_getchar(const uart_t *uart, uint8_t *data);
 
-size_t uart_read(const uart_t *uart, const uint8_t *data, size_t len);
+/**
+ * @param uart Pointer to uart_t represting the target UART.
+ * @return true if `uart_getchar` would return without waiting (a byte in the
+ * RX ring after `uart_async_init()`, in the RX FIFO before).
+ */
+bool uart_rx_ready(const uart_t *uart);
+
+size_t uart_read(const uart_t *uart, uint8_t *data, size_t len);
 
 size_t uart_sink(void *uart, const char *data, size_t len);
 
+/**
+ * Set the RX and TX FIFO interrupt watermarks without resetting the FIFOs.
+ *
+ * @param uart Pointer to uart_t represting the target UART.
+ * @param rx RX FIFO level that raises rx_watermark.
+ * @param tx TX FIFO level below which tx_watermark is raised.
+ * @return kErrorOk if successful, else an error code.
+ */
+system_error_t uart_set_watermarks(const uart_t *uart, uart_rx_watermark_t rx,
+                                   uart_tx_watermark_t tx);
+
+/**
+ * Switch an initialized UART to interrupt-driven operation.
+ *
+ * Empties the software rings, programs the watermarks and the RX timeout and
+ * enables the RX interrupts; TX interrupts are enabled on demand by
+ * `uart_write_async()`. The caller enables the UART sources (UART_INTR_* in
+ * core_v_mini_mcu.h) in the PLIC, sets MIE.MEIE and, from
+ * `handler_irq_external()`, claims the source, calls `uart_irq_handler()` and
+ * completes it.
+ *
+ * @param uart Pointer to uart_t represting the target UART.
+ * @param rx RX FIFO level that raises rx_watermark.
+ * @param tx TX FIFO level below which tx_watermark is raised.
+ * @return kErrorOk if successful, else an error code.
+ */
+system_error_t uart_async_init(const uart_t *uart, uart_rx_watermark_t rx,
+                               uart_tx_watermark_t tx);
+
+/**
+ * Queue a buffer for transmission and return immediately.
+ *
+ * @param uart Pointer to uart_t represting the target UART.
+ * @param data Pointer to buffer to write.
+ * @param len Length of the buffer to write.
+ * @return Number of bytes queued, less than `len` if the TX ring is full.
+ */
+size_t uart_write_async(const uart_t *uart, const uint8_t *data, size_t len);
+
+/**
+ * @param uart Pointer to uart_t represting the target UART.
+ * @return Number of bytes still waiting in the TX ring.
+ */
+size_t uart_tx_pending(const uart_t *uart);
+
+/**
+ * Move bytes from the TX ring into the TX FIFO without waiting. Code that
+ * runs with interrupts off, such as the trap handlers, calls it while idle
+ * to keep the ring draining.
+ *
+ * @param uart Pointer to uart_t represting the target UART.
+ */
+void uart_tx_poll(const uart_t *uart);
+
+/**
+ * Wait until the TX ring is empty, then wait for the transmitter. With
+ * interrupts on the core sleeps (`wfi`) between refill interrupts; with
+ * MSTATUS.MIE off the FIFO is refilled by polling.
+ *
+ * @param uart Pointer to uart_t represting the target UART.
+ */
+void uart_flush_async(const uart_t *uart);
+
+/**
+ * @param uart Pointer to uart_t represting the target UART.
+ * @return Number of received bytes waiting in the RX ring.
+ */
+size_t uart_read_available(const uart_t *uart);
+
+/**
+ * Copy up to `len` received bytes out of the RX ring without blocking.
+ *
+ * @param uart Pointer to uart_t represting the target UART.
+ * @param data Pointer to the destination buffer.
+ * @param len Size of the destination buffer.
+ * @return Number of bytes copied.
+ */
+size_t uart_read_async(const uart_t *uart, uint8_t *data, size_t len);
+
+/**
+ * @param uart Pointer to uart_t represting the target UART.
+ * @return Number of bytes dropped because the RX ring was full.
+ */
+size_t uart_rx_dropped_count(const uart_t *uart);
+
+/**
+ * Service the UART interrupt: drain the RX FIFO into the RX ring and refill
+ * the TX FIFO from the TX ring.
+ *
+ * @param uart Pointer to uart_t represting the target UART.
+ */
+void uart_irq_handler(const uart_t *uart);
+
 #ifdef __cplusplus
 }
 #endif
@@ -5,6 +5,7 @@
 #include "handler.h"
 
 #include "csr.h"
+#include "dma_queue.h"
 #include "stdasm.h"
 
 /**
@@ -31,27 +32,12 @@ static void print_exc_msg(const char *msg) {
 
 // Below functions are default weak exception handlers meant to be overriden
 __attribute__((weak, aligned(4))) void handler_exception(void) {
-  uint32_t syscall_id;
-  uint32_t   a1;
-  uintptr_t  a0;
-  asm volatile("mv %0, a0" : "=r"(a0));
-  asm volatile("mv %0, a1" : "=r"(a1));
-  asm volatile("mv %0, a7" : "=r"(syscall_id));
-    
-//   uintptr_t  sp;
-//   asm volatile("mv %0, sp" : "=r"(sp));
-//     printf("%lx\r\n",sp);
-    
-    
   uint32_t mcause;
   exc_id_t exc_cause;
 
   CSR_READ(CSR_REG_MCAUSE, &mcause);
   exc_cause = (exc_id_t)(mcause & kIdMax);
-    
-  uintptr_t mepc;
-  asm volatile("csrr %0, mepc" : "=r"(mepc));
- 
+
   switch (exc_cause) {
     case kInstMisa:
       handler_instr_acc_fault();
@@ -74,60 +60,6 @@ __attribute__((weak, aligned(4))) void handler_exception(void) {
     case kECall:
       handler_ecall();
       break;
-    case uECall:
-
-      /* ------------ make room and save ra + gp + tp + s0–s11 ------------- */
-    asm volatile(
-        "addi   sp,  sp,  -60\n"   /* 15×4 = 60 bytes                     */
-        "sw     ra,  56(sp)\n"
-        "sw     gp,  52(sp)\n"
-        "sw     tp,  48(sp)\n"
-        "sw     s0,  44(sp)\n"
-        "sw     s1,  40(sp)\n"
-        "sw     s2,  36(sp)\n"
-        "sw     s3,  32(sp)\n"
-        "sw     s4,  28(sp)\n"
-        "sw     s5,  24(sp)\n"
-        "sw     s6,  20(sp)\n"
-        "sw     s7,  16(sp)\n"
-        "sw     s8,  12(sp)\n"
-        "sw     s9,   8(sp)\n"
-        "sw     s10,  4(sp)\n"
-        "sw     s11,  0(sp)\n"
-        ::: "memory");
- 
-      //---------------------------
-      handler_user_ecall(syscall_id,a0,a1);
-      //---------------------------
- 
-      uintptr_t mepc;
-      asm volatile("csrr %0, mepc" : "=r"(mepc));
-      uint16_t instr = *(uint16_t *)mepc;  // read instruction at trap address
-      mepc += (instr & 0x3) == 0x3 ? 4 : 2;
-      asm volatile("csrw mepc, %0" :: "r"(mepc));
-          /* ----------------------- restore the frame ------------------------- */
-    asm volatile(
-        "lw     s11,  0(sp)\n"
-        "lw     s10,  4(sp)\n"
-        "lw     s9,   8(sp)\n"
-        "lw     s8,  12(sp)\n"
-        "lw     s7,  16(sp)\n"
-        "lw     s6,  20(sp)\n"
-        "lw     s5,  24(sp)\n"
-        "lw     s4,  28(sp)\n"
-        "lw     s3,  32(sp)\n"
-        "lw     s2,  36(sp)\n"
-        "lw     s1,  40(sp)\n"
-        "lw     s0,  44(sp)\n"
-        "lw     tp,  48(sp)\n"
-        "lw     gp,  52(sp)\n"
-        "lw     ra,  56(sp)\n"
-        "addi   sp,  sp,  60\n"
-        ::: "memory");
-
-      asm volatile("mret");
-      break;
-      //---------------------------
     default:
       while (1) {
       };
@@ -171,9 +103,7 @@ __attribute__((weak)) void handler_irq_fast_timer_3(void) {
 }
 
 __attribute__((weak)) void handler_irq_fast_dma(void) {
-  printf("Fast dma IRQ triggered!\n");
-  while (1) {
-  }
+  dma_queue_irq_handler();
 }
 
 __attribute__((weak)) void handler_irq_fast_spi(void) {
@@ -265,70 +195,11 @@ __attribute__((weak)) void handler_ecall(void) {
   }
 }
 
-#include "tee_syscall.h"
-#include "uart.h"
-#include "lenet5_test.h"
-#include <string.h>
-#include "scpi/scpi.h"
-
-extern volatile uart_t uart;
-extern volatile scpi_t scpi_context;
-
-__attribute__((weak)) void handler_user_ecall(uint32_t syscall_id,uintptr_t  ptr,uint32_t len) {
-
-  switch (syscall_id) {
-          
-    case TEE_EC_INFER:
-        const uint32_t ram2_lo = 0x00078000;
-        const uint32_t ram2_hi = 0x00080000;
-        if ((ptr < ram2_lo) || (ptr + len > ram2_hi)) {
-            printf("[M] Bad user buffer (0x%08lx, len=%u)\r\n", (long)ptr, len);
-            return;                    /* or place error code in a0 */
-        }
-        printf("Len = %u\r\n",len);
-        const char *input = (const char *)ptr;
-        if (len > 0) {
-            //printf("Got command\r\n");
-            SCPI_Input(&scpi_context, input, len);
-            SCPI_Input(&scpi_context, "\r\n", 2);
-        }
-        SCPI_Flush(&scpi_context);
-        break;
-    
-    case TEE_EC_UART_PUTCHAR: 
-        uart_putchar(&uart, (uint8_t)ptr);
-      break;
-        
-    case TEE_EC_UART_GETCHAR: 
-      uint8_t c;
-      uart_getchar(&uart, &c);
-      asm volatile("mv a0, %0" :: "r"(c));  // return value in a0
-      break;
-    
-    case TEE_EC_RDCOUNTERS: 
-
-        uint32_t c_lo, c_hi, i_lo, i_hi;
-        asm volatile (
-            "csrr %0, mcycle   \n"
-            "csrr %1, mcycleh  \n"
-            "csrr %2, minstret \n"
-            "csrr %3, minstreth"
-            : "=r"(c_lo), "=r"(c_hi), "=r"(i_lo), "=r"(i_hi));
-
-         printf("%lx\n\r",c_lo);
-         printf("%lx\n\r",c_hi);
-         printf("%lx\n\r",i_lo);
-         printf("%lx\n\r",i_hi);
-
-        /* optionally return 0 in a0 */
-        asm volatile ("" :: "r"(0) : "a0");
-    break;
-              
-    default:
-        printf("[M] Unknown syscall ID: %u\n", syscall_id);
-        while (1);
-        break;
+__attribute__((weak)) const handler_syscall_t handler_syscall_table[1] = {0};
+__attribute__((weak)) const uint32_t handler_syscall_count = 0;
+
+__attribute__((weak)) uint32_t handler_syscall_unknown(uint32_t syscall_id) {
+  printf("[M] Unknown syscall ID: %u\n", syscall_id);
+  while (1) {
   }
 }
-
-
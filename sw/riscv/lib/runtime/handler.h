@@ -42,7 +42,9 @@ typedef enum exc_id {
 // must not contain more than one weak definition of the same symbol.
 
 /**
- * Default exception handler.
+ * Default exception handler. Vector 0 enters `syscall_entry`
+ * (crt/syscall_entry.S), which serves U-mode ecalls itself and jumps here for
+ * every other exception.
  *
  * `handler.c` provides a weak definition of this symbol, which can be overriden
  * at link-time by providing an additional non-weak definition.
@@ -101,7 +103,8 @@ INTERRUPT_HANDLER_ABI void handler_irq_fast_timer_3(void);
  * Fast dma IRQ handler.
  *
  * `handler.c` provides a weak definition of this symbol, which can be overriden
- * at link-time by providing an additional non-weak definition.
+ * at link-time by providing an additional non-weak definition. The default
+ * services the DMA descriptor queue (see dma_queue.h).
  */
 INTERRUPT_HANDLER_ABI void handler_irq_fast_dma(void);
 
@@ -241,14 +244,37 @@ void handler_lsu_fault(void);
 void handler_ecall(void);
 
 /**
- * User-mode exception call handler.
+ * U-mode system call, dispatched by `syscall_entry` (crt/syscall_entry.S)
+ * with a0 and a1 of the ecall as arguments. The return value is handed back
+ * to U-mode in a0.
+ */
+typedef uint32_t (*handler_syscall_t)(uintptr_t arg0, uint32_t arg1);
+
+/**
+ * System call table, indexed by the id in a7, and its number of entries.
  *
- * Called by default implementation of `handler_exception`. If that function is
- * overriden, this function may not be called.
+ * `handler.c` provides an empty weak table. Applications taking ecalls from
+ * U-mode define their own with `HANDLER_SYSCALL_TABLE`.
+ */
+extern const handler_syscall_t handler_syscall_table[];
+extern const uint32_t handler_syscall_count;
+
+/**
+ * Defines `handler_syscall_table` from its initializers (designated
+ * initializers may leave holes) and sets `handler_syscall_count` to match.
+ */
+#define HANDLER_SYSCALL_TABLE(...)                                 \
+  const handler_syscall_t handler_syscall_table[] = {__VA_ARGS__}; \
+  const uint32_t handler_syscall_count =                           \
+      sizeof(handler_syscall_table) / sizeof(handler_syscall_table[0])
+
+/**
+ * Called for ecall ids outside the system call table or without an entry.
+ * Its return value is handed back to U-mode in a0.
  *
  * `handler.c` provides a weak definition of this symbol, which can be overriden
  * at link-time by providing an additional non-weak definition.
  */
-void handler_user_ecall(uint32_t syscall_id,uintptr_t  buf_ptr,uint32_t len);
+uint32_t handler_syscall_unknown(uint32_t syscall_id);
 
 #endif  // OPENTITAN_SW_DEVICE_LIB_HANDLER_H_
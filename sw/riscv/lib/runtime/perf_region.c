@@ -0,0 +1,100 @@
+// Copyright EPFL contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "perf_region.h"
+
+#include <stdbool.h>
+
+#include "core_v_mini_mcu.h"
+#include "csr.h"
+#include "gpio_regs.h"
+#include "mmio.h"
+#include "perf_stats.h"
+
+enum {
+  kPerfRegionMask = ((1u << PERF_REGION_PINS) - 1) << PERF_REGION_FIRST_PIN,
+};
+
+static uint32_t perf_region_stack[PERF_REGION_MAX_DEPTH];
+static perf_counters_t perf_region_start[PERF_REGION_MAX_DEPTH];
+static uint32_t perf_region_depth = 0;
+static uint32_t perf_region_folded = 0;
+static bool perf_region_ready = false;
+
+/**
+ * Drive `id` on all marker pins with a single GPIO_OUT write, so the host never
+ * samples a mix of two ids. Called with interrupts masked.
+ */
+static void perf_region_drive(uint32_t id) {
+  mmio_region_t gpio = mmio_region_from_addr((uintptr_t)GPIO_AO_START_ADDRESS);
+
+  if (!perf_region_ready) {
+    // Push-pull output mode is 2'b01 in the two-bit field of each pin
+    uint32_t mode = mmio_region_read32(gpio, GPIO_GPIO_MODE_0_REG_OFFSET);
+    for (uint32_t pin = PERF_REGION_FIRST_PIN;
+         pin < PERF_REGION_FIRST_PIN + PERF_REGION_PINS; ++pin) {
+      mode = (mode & ~(3u << (2 * pin))) | (1u << (2 * pin));
+    }
+    mmio_region_write32(gpio, GPIO_GPIO_MODE_0_REG_OFFSET, mode);
+    perf_region_ready = true;
+  }
+
+  uint32_t out = mmio_region_read32(gpio, GPIO_GPIO_OUT_REG_OFFSET);
+  out = (out & ~kPerfRegionMask) |
+        ((id << PERF_REGION_FIRST_PIN) & kPerfRegionMask);
+  mmio_region_write32(gpio, GPIO_GPIO_OUT_REG_OFFSET, out);
+}
+
+void perf_region_begin(uint32_t id) {
+  uint32_t mstatus;
+  CSR_READ(CSR_REG_MSTATUS, &mstatus);
+  CSR_CLEAR_BITS(CSR_REG_MSTATUS, 0x8);
+
+  if (perf_region_depth < PERF_REGION_MAX_DEPTH) {
+    perf_region_stack[perf_region_depth] = id;
+    perf_region_drive(id);
+    // Read last, so that the bookkeeping is outside of the measurement
+    perf_counters_read(&perf_region_start[perf_region_depth++]);
+  } else {
+    perf_region_folded++;
+  }
+
+  if (mstatus & 0x8) {
+    CSR_SET_BITS(CSR_REG_MSTATUS, 0x8);
+  }
+}
+
+void perf_region_end(uint32_t id) {
+  uint32_t mstatus;
+  CSR_READ(CSR_REG_MSTATUS, &mstatus);
+  CSR_CLEAR_BITS(CSR_REG_MSTATUS, 0x8);
+
+  // Read first, for the same reason
+  perf_counters_t now;
+  perf_counters_read(&now);
+
+  if (perf_region_folded > 0) {
+    perf_region_folded--;
+  } else if (perf_region_depth > 0 &&
+             perf_region_stack[perf_region_depth - 1] == id) {
+    perf_region_depth--;
+    perf_counters_t delta = {
+        .cycles = now.cycles - perf_region_start[perf_region_depth].cycles,
+        .instret = now.instret - perf_region_start[perf_region_depth].instret,
+    };
+    perf_stats_record(id, &delta);
+    perf_region_drive(perf_region_depth > 0
+                          ? perf_region_stack[perf_region_depth - 1]
+                          : kPerfRegionNone);
+  }
+
+  if (mstatus & 0x8) {
+    CSR_SET_BITS(CSR_REG_MSTATUS, 0x8);
+  }
+}
+
+uint32_t perf_region_current(void) {
+  return perf_region_depth > 0 ? perf_region_stack[perf_region_depth - 1]
+                               : kPerfRegionNone;
+}
@@ -0,0 +1,69 @@
+// Copyright EPFL contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef _RUNTIME_PERF_REGION_H_
+#define _RUNTIME_PERF_REGION_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * The id of the innermost open region is driven on GPIO_AO pins
+ * [PERF_REGION_FIRST_PIN, PERF_REGION_FIRST_PIN + PERF_REGION_PINS), next to
+ * pin 0 that gates the FPGA performance counters for the whole program. The
+ * host samples them together with the counters to attribute counter deltas to
+ * regions (see `start_perf_cnt_sampling()` in x_heep_api.py).
+ */
+#define PERF_REGION_FIRST_PIN 2
+#define PERF_REGION_PINS 6
+
+/**
+ * Maximum nesting depth; deeper regions are folded into their parent.
+ */
+#ifndef PERF_REGION_MAX_DEPTH
+#define PERF_REGION_MAX_DEPTH 8
+#endif
+
+/**
+ * Region ids. 0 is driven outside of any region; ids below kPerfRegionUser are
+ * used by the runtime, applications number theirs from kPerfRegionUser up to
+ * (1 << PERF_REGION_PINS) - 1.
+ */
+typedef enum perf_region_id {
+  kPerfRegionNone      = 0,
+  kPerfRegionScpiInput = 1,
+  kPerfRegionUser      = 8,
+} perf_region_id_t;
+
+/**
+ * Open region `id`: its id is driven on the marker pins until the matching
+ * `perf_region_end()`. Regions nest; an inner region takes over the pins and
+ * the outer one is restored when it ends. The pins are configured as outputs
+ * on the first call. Must run in M-mode, as mcycle/minstret are read to
+ * record the region in perf_stats.
+ * @param id Region id, 1 to (1 << PERF_REGION_PINS) - 1.
+ */
+void perf_region_begin(uint32_t id);
+
+/**
+ * Close region `id`, add its mcycle/minstret delta (including nested regions)
+ * to the perf_stats of `id` and drive the id of the enclosing region (or
+ * kPerfRegionNone). Unbalanced calls and folded regions are not recorded.
+ * @param id Id passed to the matching `perf_region_begin()`.
+ */
+void perf_region_end(uint32_t id);
+
+/**
+ * @return The id of the innermost open region, kPerfRegionNone if none.
+ */
+uint32_t perf_region_current(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _RUNTIME_PERF_REGION_H_
@@ -0,0 +1,81 @@
+// Copyright EPFL contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "perf_stats.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "csr.h"
+
+static perf_stats_t perf_stats[PERF_STATS_REGIONS];
+static bool perf_counters_ready = false;
+
+void perf_counters_read(perf_counters_t *now) {
+  uint32_t hi, lo, hi2;
+
+  if (!perf_counters_ready) {
+    // Bit 0 inhibits mcycle, bit 2 minstret
+    CSR_CLEAR_BITS(CSR_REG_MCOUNTINHIBIT, 0x5);
+    perf_counters_ready = true;
+  }
+
+  // Re-read when the low word wrapped between the two high word reads
+  do {
+    CSR_READ(CSR_REG_MCYCLEH, &hi);
+    CSR_READ(CSR_REG_MCYCLE, &lo);
+    CSR_READ(CSR_REG_MCYCLEH, &hi2);
+  } while (hi != hi2);
+  now->cycles = ((uint64_t)hi << 32) | lo;
+
+  do {
+    CSR_READ(CSR_REG_MINSTRETH, &hi);
+    CSR_READ(CSR_REG_MINSTRET, &lo);
+    CSR_READ(CSR_REG_MINSTRETH, &hi2);
+  } while (hi != hi2);
+  now->instret = ((uint64_t)hi << 32) | lo;
+}
+
+static uint32_t perf_stats_bin(uint64_t cycles) {
+  if (cycles == 0) {
+    return 0;
+  }
+  int32_t log2 = 63 - __builtin_clzll(cycles);
+  int32_t bin = log2 - PERF_STATS_HIST_FIRST_LOG2;
+  if (bin < 0) {
+    return 0;
+  }
+  if (bin >= PERF_STATS_HIST_BINS) {
+    return PERF_STATS_HIST_BINS - 1;
+  }
+  return (uint32_t)bin;
+}
+
+void perf_stats_record(uint32_t region, const perf_counters_t *delta) {
+  if (region >= PERF_STATS_REGIONS) {
+    return;
+  }
+  perf_stats_t *stats = &perf_stats[region];
+
+  if (stats->count == 0 || delta->cycles < stats->min_cycles) {
+    stats->min_cycles = delta->cycles;
+  }
+  if (stats->count == 0 || delta->cycles > stats->max_cycles) {
+    stats->max_cycles = delta->cycles;
+  }
+  stats->count++;
+  stats->sum_cycles += delta->cycles;
+  stats->sum_instret += delta->instret;
+  stats->hist[perf_stats_bin(delta->cycles)]++;
+}
+
+const perf_stats_t *perf_stats_get(uint32_t region) {
+  return region < PERF_STATS_REGIONS ? &perf_stats[region] : NULL;
+}
+
+void perf_stats_reset(void) {
+  for (uint32_t i = 0; i < PERF_STATS_REGIONS; ++i) {
+    perf_stats[i] = (perf_stats_t){0};
+  }
+}
@@ -0,0 +1,84 @@
+// Copyright EPFL contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef _RUNTIME_PERF_STATS_H_
+#define _RUNTIME_PERF_STATS_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Number of region ids with statistics, indexed like perf_region ids.
+ */
+#ifndef PERF_STATS_REGIONS
+#define PERF_STATS_REGIONS 16
+#endif
+
+/**
+ * Cycle histogram: bin 0 counts measurements below
+ * 2^(PERF_STATS_HIST_FIRST_LOG2 + 1) cycles, bin k those in
+ * [2^(PERF_STATS_HIST_FIRST_LOG2 + k), 2^(PERF_STATS_HIST_FIRST_LOG2 + k + 1))
+ * and the last bin everything above.
+ */
+#ifndef PERF_STATS_HIST_BINS
+#define PERF_STATS_HIST_BINS 16
+#endif
+#ifndef PERF_STATS_HIST_FIRST_LOG2
+#define PERF_STATS_HIST_FIRST_LOG2 10
+#endif
+
+/**
+ * A 64-bit mcycle/minstret pair, either a reading or a delta.
+ */
+typedef struct perf_counters {
+  uint64_t cycles;
+  uint64_t instret;
+} perf_counters_t;
+
+/**
+ * Statistics of the deltas recorded for one region.
+ */
+typedef struct perf_stats {
+  uint32_t count;
+  uint64_t min_cycles;
+  uint64_t max_cycles;
+  uint64_t sum_cycles;
+  uint64_t sum_instret;
+  uint32_t hist[PERF_STATS_HIST_BINS];
+} perf_stats_t;
+
+/**
+ * Read mcycle and minstret as consistent 64-bit values. Counting is enabled in
+ * mcountinhibit on the first call. Must run in M-mode.
+ * @param now Where to store the reading.
+ */
+void perf_counters_read(perf_counters_t *now);
+
+/**
+ * Add one measurement to the statistics of `region`. Ids without a slot are
+ * ignored.
+ * @param region Region id, below PERF_STATS_REGIONS.
+ * @param delta Counter delta of the measurement.
+ */
+void perf_stats_record(uint32_t region, const perf_counters_t *delta);
+
+/**
+ * @param region Region id.
+ * @return The statistics of `region`, or NULL if it has no slot.
+ */
+const perf_stats_t *perf_stats_get(uint32_t region);
+
+/**
+ * Clear the statistics of all regions.
+ */
+void perf_stats_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _RUNTIME_PERF_STATS_H_
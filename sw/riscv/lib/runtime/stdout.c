@@ -0,0 +1,90 @@
+// Copyright EPFL contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "stdout.h"
+
+#include <stdbool.h>
+
+#include "uart.h"
+#include "soc_ctrl.h"
+#include "core_v_mini_mcu.h"
+#include "error.h"
+#include "pynq-z2.h"
+
+static uart_t stdout_uart;
+static bool stdout_ready = false;
+
+#if !STDOUT_UNBUFFERED
+static uint8_t stdout_ring[STDOUT_BUFFER_SIZE];
+static size_t stdout_head = 0;   // next free slot
+static size_t stdout_count = 0;  // bytes waiting to be sent
+#endif
+
+/**
+ * Program the UART once. Re-running uart_init() resets the FIFOs, which drops
+ * whatever is still being shifted out.
+ */
+static bool stdout_init(void) {
+  if (stdout_ready) {
+    return true;
+  }
+
+  soc_ctrl_t soc_ctrl;
+  soc_ctrl.base_addr = mmio_region_from_addr((uintptr_t)SOC_CTRL_START_ADDRESS);
+
+  stdout_uart.base_addr   = mmio_region_from_addr((uintptr_t)UART_START_ADDRESS);
+  stdout_uart.baudrate    = UART_BAUDRATE;
+  stdout_uart.clk_freq_hz = soc_ctrl_get_frequency(&soc_ctrl);
+
+  if (uart_init(&stdout_uart) != kErrorOk) {
+    return false;
+  }
+  stdout_ready = true;
+  return true;
+}
+
+int stdout_flush(void) {
+  if (!stdout_init()) {
+    return -1;
+  }
+#if !STDOUT_UNBUFFERED
+  while (stdout_count > 0) {
+    size_t tail = (stdout_head + STDOUT_BUFFER_SIZE - stdout_count) % STDOUT_BUFFER_SIZE;
+    size_t chunk = STDOUT_BUFFER_SIZE - tail;
+    if (chunk > stdout_count) {
+      chunk = stdout_count;
+    }
+    uart_write(&stdout_uart, &stdout_ring[tail], chunk);
+    stdout_count -= chunk;
+  }
+#endif
+  return 0;
+}
+
+int stdout_write(const void *data, size_t len) {
+  if (!stdout_init()) {
+    return -1;
+  }
+#if STDOUT_UNBUFFERED
+  return uart_write(&stdout_uart, (const uint8_t *)data, len);
+#else
+  const uint8_t *data8 = (const uint8_t *)data;
+  bool newline = false;
+
+  for (size_t i = 0; i < len; ++i) {
+    if (stdout_count == STDOUT_BUFFER_SIZE) {
+      stdout_flush();
+    }
+    stdout_ring[stdout_head] = data8[i];
+    stdout_head = (stdout_head + 1) % STDOUT_BUFFER_SIZE;
+    stdout_count++;
+    newline |= (data8[i] == '\n');
+  }
+
+  if (newline) {
+    stdout_flush();
+  }
+  return len;
+#endif
+}
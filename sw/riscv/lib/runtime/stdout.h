@@ -0,0 +1,58 @@
+// Copyright EPFL contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef _RUNTIME_STDOUT_H_
+#define _RUNTIME_STDOUT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Size in bytes of the RAM ring buffer in front of the UART.
+ */
+#ifndef STDOUT_BUFFER_SIZE
+#define STDOUT_BUFFER_SIZE 256
+#endif
+
+/**
+ * Build with -DSTDOUT_UNBUFFERED=1 to send every write straight to the UART.
+ */
+#ifndef STDOUT_UNBUFFERED
+#define STDOUT_UNBUFFERED 0
+#endif
+
+/**
+ * Queue bytes for the stdout UART.
+ *
+ * The UART is initialised on the first call only. Bytes are kept in the ring
+ * buffer and drained when it fills up or when a '\n' is written.
+ *
+ * @param data Pointer to buffer to write.
+ * @param len Length of the buffer to write.
+ * @return Number of bytes accepted, or -1 if the UART cannot be initialised.
+ */
+int stdout_write(const void *data, size_t len);
+
+/**
+ * Drain the ring buffer to the UART.
+ *
+ * Called at the end of every `_write()`: newlib's stdio keeps its own buffer
+ * and only calls `_write()` when that is due, `fflush(stdout)` included, so
+ * stdio output reaches the UART no later than stdio releases it. Also called
+ * by `_exit()` and `fsync(1)`. Direct `stdout_write()` callers call it
+ * explicitly before anything that resets the UART or stops the clock.
+ *
+ * @return 0 on success, -1 if the UART cannot be initialised.
+ */
+int stdout_flush(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _RUNTIME_STDOUT_H_
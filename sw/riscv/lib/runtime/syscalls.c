@@ -27,6 +27,7 @@
 #include "error.h"
 #include "pynq-z2.h"
 #include "gpio.h"
+#include "stdout.h"
 
 #undef errno
 extern int errno;
@@ -95,6 +96,9 @@ int _execve(const char *name, char *const argv[], char *const env[])
 
 void _exit(int exit_status)
 {
+    // Drain buffered output while the UART is still clocked
+    stdout_flush();
+
     // Stop performance counters
     gpio_params_t gpio_params;
     gpio_t gpio;
@@ -254,21 +258,23 @@ ssize_t _write(int file, const void *ptr, size_t len)
         return -1;
     }
 
-    soc_ctrl_t soc_ctrl;
-    soc_ctrl.base_addr = mmio_region_from_addr((uintptr_t)SOC_CTRL_START_ADDRESS);
-
-    uart_t uart;
-    uart.base_addr   = mmio_region_from_addr((uintptr_t)UART_START_ADDRESS);
-    uart.baudrate    = UART_BAUDRATE;
-    uart.clk_freq_hz = soc_ctrl_get_frequency(&soc_ctrl);
-
-    if (uart_init(&uart) != kErrorOk) {
+    /* stdio calls _write() once its own buffer is due, fflush() included, so
+     * the ring is drained here rather than left waiting for a newline */
+    int written = stdout_write(ptr, len);
+    if (written < 0 || stdout_flush() < 0) {
         errno = ENOSYS;
         return -1;
     }
+    return written;
+}
 
-    return uart_write(&uart,(uint8_t *)ptr,len);
-
+int _fsync(int file)
+{
+    if (file != STDOUT_FILENO) {
+        errno = EINVAL;
+        return -1;
+    }
+    return stdout_flush();
 }
 
 extern char __heap_start[];